@@ -0,0 +1,85 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#include <cassert>
+
+#include "abstractmaps.h"
+#include "dungeonmaster.h"
+#include "map.h"
+
+//============================================================================
+// AbstractMaps
+//============================================================================
+AbstractMaps::AbstractMaps(unsigned int quantum) :
+    m_maps(),
+    m_due(),
+    m_quantum(quantum)
+{
+    assert(quantum > 0 && "Illegal quantum submitted to AbstractMaps");
+}
+
+
+void
+AbstractMaps::setQuantum(unsigned int quantum)
+{
+    assert(quantum > 0 && "Illegal quantum submitted to setQuantum()");
+    m_quantum = quantum;
+}
+
+
+bool
+AbstractMaps::contains(MapH mp) const
+{
+    return m_maps.count(mp) != 0;
+}
+
+
+void
+AbstractMaps::add(MapH mp, DungeonMasterH dm, unsigned int now)
+{
+    assert(!contains(mp) && "Map added to AbstractMaps twice");
+    Entry const entry = { now, dm };
+    m_maps.insert(Maps::value_type(mp, entry));
+    m_due.insert(std::make_pair(now, mp));
+    mp->evictChunks(0);
+}
+
+
+void
+AbstractMaps::restore(MapH mp, unsigned int now)
+{
+    Maps::iterator it = m_maps.find(mp);
+    assert(it != m_maps.end() && "Map restored which wasn't abstract");
+    m_due.erase(std::make_pair(it->second.until, mp));
+    if (now > it->second.until)
+        it->second.dm->simulateAbstract(mp, now - it->second.until);
+    m_maps.erase(it);
+    mp->skipToTurn(now);
+}
+
+
+void
+AbstractMaps::remove(MapH mp)
+{
+    Maps::iterator it = m_maps.find(mp);
+    if (it == m_maps.end())
+        return;
+    m_due.erase(std::make_pair(it->second.until, mp));
+    m_maps.erase(it);
+}
+
+
+void
+AbstractMaps::advance(unsigned int turn)
+{
+    while (!m_due.empty() && m_due.begin()->first + m_quantum <= turn)
+    {
+        MapH mp = m_due.begin()->second;
+        m_due.erase(m_due.begin());
+        Entry & entry = m_maps[mp];
+        entry.dm->simulateAbstract(mp, m_quantum);
+        entry.until += m_quantum;
+        m_due.insert(std::make_pair(entry.until, mp));
+    }
+}
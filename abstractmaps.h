@@ -0,0 +1,105 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#ifndef H_ABSTRACTMAPS_
+#define H_ABSTRACTMAPS_ 1
+
+#include <map>
+#include <set>
+#include <utility>
+
+#include "boost/noncopyable.hpp"
+
+#include "handles.h"
+
+
+/**
+ * AbstractMaps holds the Maps World::setAbstractDistance() has taken out of
+ * the timeline. Their Actors don't act; instead, every quantum ticks each
+ * Map's DungeonMaster::simulateAbstract() passes that much time at once.
+ * A Map brought back is caught up to the present, and its Actors resume
+ * from then on.
+ */
+class AbstractMaps : private boost::noncopyable
+{
+public:
+    /**
+     * @param quantum  ticks passed in each abstract step
+     */
+    explicit AbstractMaps(unsigned int quantum);
+
+    /**
+     * Change the ticks passed in each abstract step. Maps already held
+     * keep the time they have been simulated up to.
+     *
+     * @param quantum  ticks, more than 0
+     */
+    void setQuantum(unsigned int quantum);
+
+    /**
+     * Are there no abstract Maps?
+     *
+     * @return         true if none
+     */
+    bool empty() const { return m_maps.empty(); }
+
+    /**
+     * Is the Map held here?
+     *
+     * @param mp       map to look for
+     * @return         true if it is abstract
+     */
+    bool contains(MapH mp) const;
+
+    /**
+     * Make a Map abstract. Its chunks are evicted, as no one will look at
+     * its squares for a while.
+     *
+     * @param mp       map not already held, already out of the timeline
+     * @param dm       the DungeonMaster the map belongs to
+     * @param now      current turn
+     */
+    void add(MapH mp, DungeonMasterH dm, unsigned int now);
+
+    /**
+     * Bring a Map back: pass whatever part of a quantum is left up to
+     * now, then move every Actor still behind up to now with
+     * Map::skipToTurn()
+     *
+     * @param mp       map held here
+     * @param now      current turn
+     */
+    void restore(MapH mp, unsigned int now);
+
+    /**
+     * Drop a Map without catching it up
+     *
+     * @param mp       map, which need not be held here
+     */
+    void remove(MapH mp);
+
+    /**
+     * Pass every quantum which has ended by a turn, oldest first
+     *
+     * @param turn     current turn
+     */
+    void advance(unsigned int turn);
+
+private:
+    struct Entry
+    {
+        unsigned int   until;     // simulated up to this turn
+        DungeonMasterH dm;        // whose simulateAbstract() to use
+    };
+    typedef std::map<MapH, Entry>                      Maps;
+    typedef std::set<std::pair<unsigned int, MapH> >   Due;     // by until
+
+    Maps         m_maps;
+    Due          m_due;
+    unsigned int m_quantum;
+};
+
+
+
+#endif
@@ -11,7 +11,9 @@
 //============================================================================
 Actor::Actor() :
     m_coords(-1, -1),
-    m_turn(0)
+    m_turn(0),
+    m_queue_index(-1),
+    m_queue_seq(0)
 {
 }
 
@@ -5,8 +5,6 @@
 // RogueMonkey copyright 2007 Adam White theroguemonkey@gmail.com
 // Released under the GPL version 2 - refer to included file LICENCE.txt
 
-#include <functional>
-
 #include "handles.h"
 #include "inputdef.h"
 #include "map.h"
@@ -73,19 +71,13 @@ protected:
     Actor();    
 
 private:
+    friend class ActorQueue;
     friend class Map;
-    friend struct ActorComp;
-
-    struct ActorComp : std::binary_function<ActorH, ActorH, bool>
-    {
-        bool operator() (ActorH l, ActorH r) const
-        {
-            return l->m_turn < r->m_turn;
-        }
-    };
 
     Coords          m_coords;
     unsigned int    m_turn;
+    int             m_queue_index;  // position in ActorQueue heap, -1 if none
+    unsigned long   m_queue_seq;    // order queued, to keep equal turns stable
 };
 
 
@@ -0,0 +1,127 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#include <cassert>
+
+#include "actor.h"
+#include "actorqueue.h"
+
+//============================================================================
+// ActorQueue
+//============================================================================
+ActorQueue::ActorQueue() :
+    m_heap(),
+    m_sequence(0)
+{
+}
+
+
+ActorH const &
+ActorQueue::top() const
+{
+    assert(!m_heap.empty() && "top() called on empty ActorQueue");
+    return m_heap.front();
+}
+
+
+bool
+ActorQueue::contains(ActorH const & act) const
+{
+    return act->m_queue_index >= 0 &&
+           act->m_queue_index < static_cast<int>(m_heap.size()) &&
+           m_heap[act->m_queue_index] == act;
+}
+
+
+void
+ActorQueue::push(ActorH const & act)
+{
+    assert(!contains(act) && "push() of Actor already in ActorQueue");
+    act->m_queue_seq = m_sequence++;
+    m_heap.push_back(act);
+    act->m_queue_index = static_cast<int>(m_heap.size()) - 1;
+    siftUp(m_heap.size() - 1);
+}
+
+
+void
+ActorQueue::reschedule(ActorH const & act)
+{
+    assert(contains(act) && "reschedule() of Actor not in ActorQueue");
+    act->m_queue_seq = m_sequence++;
+    std::size_t const i = act->m_queue_index;
+    siftUp(i);
+    siftDown(act->m_queue_index);
+}
+
+
+void
+ActorQueue::remove(ActorH const & act)
+{
+    assert(contains(act) && "remove() of Actor not in ActorQueue");
+    std::size_t const i = act->m_queue_index;
+    act->m_queue_index = -1;
+
+    ActorH const last = m_heap.back();
+    m_heap.pop_back();
+    if (i < m_heap.size())
+    {
+        place(i, last);
+        siftUp(i);
+        siftDown(last->m_queue_index);
+    }
+}
+
+
+// earlier turn first, then whoever was queued first
+bool
+ActorQueue::before(ActorH const & l, ActorH const & r) const
+{
+    return l->m_turn < r->m_turn || (l->m_turn == r->m_turn && l->m_queue_seq < r->m_queue_seq);
+}
+
+
+void
+ActorQueue::place(std::size_t i, ActorH const & act)
+{
+    m_heap[i] = act;
+    act->m_queue_index = static_cast<int>(i);
+}
+
+
+void
+ActorQueue::siftUp(std::size_t i)
+{
+    ActorH const act = m_heap[i];
+    while (i > 0)
+    {
+        std::size_t const parent = (i - 1) / 2;
+        if (!before(act, m_heap[parent]))
+            break;
+        place(i, m_heap[parent]);
+        i = parent;
+    }
+    place(i, act);
+}
+
+
+void
+ActorQueue::siftDown(std::size_t i)
+{
+    ActorH const act = m_heap[i];
+    std::size_t const n = m_heap.size();
+    for (;;)
+    {
+        std::size_t child = 2 * i + 1;
+        if (child >= n)
+            break;
+        if (child + 1 < n && before(m_heap[child + 1], m_heap[child]))
+            ++child;
+        if (!before(m_heap[child], act))
+            break;
+        place(i, m_heap[child]);
+        i = child;
+    }
+    place(i, act);
+}
@@ -0,0 +1,92 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#ifndef H_ACTORQUEUE_
+#define H_ACTORQUEUE_ 1
+
+#include <vector>
+
+#include "boost/noncopyable.hpp"
+
+#include "handles.h"
+
+
+/**
+ * ActorQueue is the turn order of the Actors on a Map: an indexed binary
+ * heap keyed on Actor::getTurn(). Each Actor remembers where it sits in the
+ * heap, so it can be rescheduled or removed in O(log n) without a search,
+ * and the next Actor is always at the top. Actors with equal turns come out
+ * in the order they were pushed or last rescheduled.
+ *
+ * An Actor can be in only one ActorQueue at a time.
+ */
+class ActorQueue : private boost::noncopyable
+{
+public:
+    ActorQueue();
+
+    /**
+     * Is the queue empty?
+     *
+     * @return      true if there are no Actors
+     */
+    bool empty() const { return m_heap.empty(); }
+
+    /**
+     * Number of Actors queued
+     *
+     * @return      size of queue
+     */
+    std::size_t size() const { return m_heap.size(); }
+
+    /**
+     * The Actor with the lowest turn
+     *
+     * @return      next actor in line
+     */
+    ActorH const & top() const;
+
+    /**
+     * Is the Actor in this queue?
+     *
+     * @param act   actor to look for
+     * @return      true if queued here
+     */
+    bool contains(ActorH const & act) const;
+
+    /**
+     * Add an Actor, behind any others on the same turn
+     *
+     * @param act   actor not already queued
+     */
+    void push(ActorH const & act);
+
+    /**
+     * Move an Actor after its turn has changed, behind any others on the
+     * new turn
+     *
+     * @param act   actor in this queue
+     */
+    void reschedule(ActorH const & act);
+
+    /**
+     * Take an Actor out of the queue
+     *
+     * @param act   actor in this queue
+     */
+    void remove(ActorH const & act);
+
+private:
+    bool before(ActorH const & l, ActorH const & r) const;
+    void place(std::size_t i, ActorH const & act);
+    void siftUp(std::size_t i);
+    void siftDown(std::size_t i);
+
+    std::vector<ActorH> m_heap;
+    unsigned long       m_sequence;
+};
+
+
+
+#endif
@@ -0,0 +1,35 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#include "bitplane.h"
+
+//============================================================================
+// Bitplane
+//============================================================================
+Bitplane::Bitplane(int x, int y, bool on) :
+    m_words(),
+    m_xsize(x),
+    m_ysize(y),
+    m_stride((x + WordBits - 1) / WordBits)
+{
+    m_words.assign(m_stride * y, on ? ~Word(0) : Word(0));
+
+    // keep squares past the right-hand edge clear
+    int const tail = x % WordBits;
+    if (on && tail)
+        for (int row = 0; row < y; ++row)
+            m_words[row * m_stride + m_stride - 1] = (Word(1) << tail) - 1;
+}
+
+
+Bitplane::Word
+Bitplane::getRow(int x, int y) const
+{
+    // round down, negative x included
+    int const w = x >= 0 ? x / WordBits : -((WordBits - 1 - x) / WordBits);
+    int const shift = x - w * WordBits;
+    if (shift == 0)
+        return getWord(w, y);
+    return (getWord(w, y) >> shift) | (getWord(w + 1, y) << (WordBits - shift));
+}
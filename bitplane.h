@@ -0,0 +1,106 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#ifndef H_BITPLANE_
+#define H_BITPLANE_ 1
+
+#include <cassert>
+#include <vector>
+
+#include "boost/cstdint.hpp"
+
+
+/**
+ * Bitplane is one bit for each square of a grid, packed 64 squares to a
+ * word along each row. Rows start on a fresh word, and bits beyond the
+ * right-hand edge are always clear, so whole words can be combined with
+ * &, | and ~ to test 64 squares at once.
+ */
+class Bitplane
+{
+public:
+    typedef boost::uint64_t Word;
+
+    enum
+    {
+        WordBits = 64
+    };
+
+    /**
+     * Create a plane with every square set or clear
+     *
+     * @param x      width of grid
+     * @param y      height of grid
+     * @param on     initial value of every square
+     */
+    Bitplane(int x, int y, bool on = false);
+
+    /**
+     * Test one square
+     *
+     * @param x      x-coordinate
+     * @param y      y-coordinate
+     * @return       true if set. Squares outside the grid are clear
+     */
+    bool test(int x, int y) const
+    {
+        if (x < 0 || y < 0 || x >= m_xsize || y >= m_ysize)
+            return false;
+        return (m_words[y * m_stride + x / WordBits] >> (x % WordBits)) & 1;
+    }
+
+    /**
+     * Set or clear one square
+     *
+     * @param x      x-coordinate, inside grid
+     * @param y      y-coordinate, inside grid
+     * @param on     new value
+     */
+    void set(int x, int y, bool on)
+    {
+        assert(x >= 0 && y >= 0 && x < m_xsize && y < m_ysize);
+        Word & word = m_words[y * m_stride + x / WordBits];
+        Word const bit = Word(1) << (x % WordBits);
+        if (on)
+            word |= bit;
+        else
+            word &= ~bit;
+    }
+
+    /**
+     * Get an aligned word of a row
+     *
+     * @param w      word of row; squares w * WordBits onwards
+     * @param y      row
+     * @return       bit i is square (w * WordBits + i, y). Zero if outside
+     */
+    Word getWord(int w, int y) const
+    {
+        if (w < 0 || y < 0 || w >= m_stride || y >= m_ysize)
+            return 0;
+        return m_words[y * m_stride + w];
+    }
+
+    /**
+     * Get the 64 squares along a row from any starting square
+     *
+     * @param x      first square, which may be outside the grid
+     * @param y      row
+     * @return       bit i is square (x + i, y). Squares outside are clear
+     */
+    Word getRow(int x, int y) const;
+
+    int getWidth() const { return m_xsize; }
+    int getHeight() const { return m_ysize; }
+
+private:
+    std::vector<Word> m_words;
+    int m_xsize;
+    int m_ysize;
+    int m_stride;
+};
+
+
+
+#endif
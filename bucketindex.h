@@ -0,0 +1,230 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#ifndef H_BUCKETINDEX_
+#define H_BUCKETINDEX_ 1
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <vector>
+
+#include "boost/noncopyable.hpp"
+
+#include "handles.h"
+
+
+/**
+ * BucketIndex sorts the squares of a grid which hold something into
+ * buckets of BucketSide x BucketSide squares, so everything near a square
+ * can be found by looking in only a few buckets. Squares are added, moved
+ * and removed as their occupants come and go.
+ *
+ * Queries call a visitor bool(Point at) for each square found, and stop
+ * early if it returns false. Nothing is allocated while visiting.
+ */
+class BucketIndex : private boost::noncopyable
+{
+public:
+    enum
+    {
+        BucketShift = 4,
+        BucketSide = 1 << BucketShift
+    };
+
+    /**
+     * Create an empty index
+     *
+     * @param x      width of grid
+     * @param y      height of grid
+     */
+    BucketIndex(int x, int y) :
+        m_buckets(((x + BucketSide - 1) >> BucketShift) * ((y + BucketSide - 1) >> BucketShift)),
+        m_buckets_x((x + BucketSide - 1) >> BucketShift),
+        m_buckets_y((y + BucketSide - 1) >> BucketShift),
+        m_size(0) {}
+
+    /**
+     * Add a square
+     *
+     * @param c      square, not already in the index
+     */
+    void insert(Point c)
+    {
+        m_buckets[bucketOf(c)].push_back(c);
+        ++m_size;
+    }
+
+    /**
+     * Remove a square
+     *
+     * @param c      square in the index
+     */
+    void remove(Point c)
+    {
+        Bucket & b = m_buckets[bucketOf(c)];
+        Bucket::iterator it = std::find(b.begin(), b.end(), c);
+        assert(it != b.end() && "BucketIndex::remove() of square not in index");
+        *it = b.back();
+        b.pop_back();
+        --m_size;
+    }
+
+    /**
+     * Move a square's entry. Cheap when both are in the same bucket.
+     *
+     * @param from   square in the index
+     * @param to     square not in the index
+     */
+    void move(Point from, Point to)
+    {
+        int const bf = bucketOf(from);
+        int const bt = bucketOf(to);
+        if (bf == bt)
+        {
+            *std::find(m_buckets[bf].begin(), m_buckets[bf].end(), from) = to;
+            return;
+        }
+        remove(from);
+        insert(to);
+    }
+
+    /**
+     * Number of squares in the index
+     *
+     * @return       squares
+     */
+    std::size_t size() const { return m_size; }
+
+    /**
+     * Visit every square within a rectangle
+     *
+     * @param tl     top left corner, inclusive
+     * @param br     bottom right corner, inclusive
+     * @param v      visitor
+     * @return       false if the visitor stopped early
+     */
+    template<typename Visitor>
+    bool visitRect(Point tl, Point br, Visitor & v) const;
+
+    /**
+     * Visit every square no further than radius in a straight line
+     *
+     * @param c      centre
+     * @param radius distance
+     * @param v      visitor
+     * @return       false if the visitor stopped early
+     */
+    template<typename Visitor>
+    bool visitRadius(Point c, int radius, Visitor & v) const
+    {
+        return visitRing(c, 0, radius, v);
+    }
+
+    /**
+     * Visit every square at least inner and no more than outer away from
+     * the centre in a straight line
+     *
+     * @param c      centre
+     * @param inner  least distance
+     * @param outer  greatest distance
+     * @param v      visitor
+     * @return       false if the visitor stopped early
+     */
+    template<typename Visitor>
+    bool visitRing(Point c, int inner, int outer, Visitor & v) const;
+
+private:
+    typedef std::vector<Point> Bucket;
+
+    int bucketOf(Point c) const
+    {
+        assert(c.X() >= 0 && c.Y() >= 0);
+        assert((c.X() >> BucketShift) < m_buckets_x && (c.Y() >> BucketShift) < m_buckets_y);
+        return (c.Y() >> BucketShift) * m_buckets_x + (c.X() >> BucketShift);
+    }
+
+    // squared distance from v to the nearest and furthest of lo..hi
+    static int NearSq(int v, int lo, int hi)
+    {
+        int const d = v < lo ? lo - v : v > hi ? v - hi : 0;
+        return d * d;
+    }
+
+    static int FarSq(int v, int lo, int hi)
+    {
+        int const d = std::max(std::abs(v - lo), std::abs(v - hi));
+        return d * d;
+    }
+
+    std::vector<Bucket> m_buckets;
+    int m_buckets_x;
+    int m_buckets_y;
+    std::size_t m_size;
+};
+
+
+template<typename Visitor>
+bool
+BucketIndex::visitRect(Point tl, Point br, Visitor & v) const
+{
+    int const bx0 = std::max(0, tl.X() >> BucketShift);
+    int const by0 = std::max(0, tl.Y() >> BucketShift);
+    int const bx1 = std::min(m_buckets_x - 1, br.X() >> BucketShift);
+    int const by1 = std::min(m_buckets_y - 1, br.Y() >> BucketShift);
+
+    for (int by = by0; by <= by1; ++by)
+        for (int bx = bx0; bx <= bx1; ++bx)
+        {
+            Bucket const & b = m_buckets[by * m_buckets_x + bx];
+            for (Bucket::const_iterator it = b.begin(); it != b.end(); ++it)
+                if (it->X() >= tl.X() && it->X() <= br.X() && it->Y() >= tl.Y() && it->Y() <= br.Y() &&
+                    !v(*it))
+                    return false;
+        }
+    return true;
+}
+
+
+template<typename Visitor>
+bool
+BucketIndex::visitRing(Point c, int inner, int outer, Visitor & v) const
+{
+    int const bx0 = std::max(0, (c.X() - outer) >> BucketShift);
+    int const by0 = std::max(0, (c.Y() - outer) >> BucketShift);
+    int const bx1 = std::min(m_buckets_x - 1, (c.X() + outer) >> BucketShift);
+    int const by1 = std::min(m_buckets_y - 1, (c.Y() + outer) >> BucketShift);
+    int const inner_sq = inner * inner;
+    int const outer_sq = outer * outer;
+
+    for (int by = by0; by <= by1; ++by)
+    {
+        int const y0 = by << BucketShift;
+        int const y1 = y0 + BucketSide - 1;
+        for (int bx = bx0; bx <= bx1; ++bx)
+        {
+            // skip buckets wholly outside the ring, or wholly inside the hole
+            int const x0 = bx << BucketShift;
+            int const x1 = x0 + BucketSide - 1;
+            if (NearSq(c.X(), x0, x1) + NearSq(c.Y(), y0, y1) > outer_sq ||
+                FarSq(c.X(), x0, x1) + FarSq(c.Y(), y0, y1) < inner_sq)
+                continue;
+
+            Bucket const & b = m_buckets[by * m_buckets_x + bx];
+            for (Bucket::const_iterator it = b.begin(); it != b.end(); ++it)
+            {
+                int const dx = it->X() - c.X();
+                int const dy = it->Y() - c.Y();
+                int const dsq = dx * dx + dy * dy;
+                if (dsq >= inner_sq && dsq <= outer_sq && !v(*it))
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+
+#endif
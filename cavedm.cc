@@ -145,7 +145,7 @@ public:
         {
             int xx = Dice::Random0(mapsz_x);
             int yy = Dice::Random0(mapsz_y);
-            Coords coord(xx, yy);
+            Point coord(xx, yy);
             if (tmp->getTerrain(coord) == Map::Grass)
             {
                 tmp->addItem(coord, Item::createItem(Dice::Random0(100) > 49 ? Item::Weapon : Item::Weapon));
@@ -0,0 +1,43 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#include <cassert>
+
+#include "changejournal.h"
+
+//============================================================================
+// ChangeJournal
+//============================================================================
+ChangeJournal::ChangeJournal(std::size_t capacity) :
+    m_ring(capacity),
+    m_version(0)
+{
+    assert(capacity > 0);
+}
+
+
+unsigned long
+ChangeJournal::record(int x, int y, MapChange::Kind kind)
+{
+    MapChange & entry = m_ring[++m_version % m_ring.size()];
+    entry.version = m_version;
+    entry.x = x;
+    entry.y = y;
+    entry.kind = kind;
+    return m_version;
+}
+
+
+bool
+ChangeJournal::getChangesSince(unsigned long since, std::vector<MapChange> & out) const
+{
+    out.clear();
+    if (since >= m_version)
+        return true;
+    if (m_version - since > m_ring.size())
+        return false;
+    for (unsigned long v = since + 1; v <= m_version; ++v)
+        out.push_back(m_ring[v % m_ring.size()]);
+    return true;
+}
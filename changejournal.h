@@ -0,0 +1,79 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#ifndef H_CHANGEJOURNAL_
+#define H_CHANGEJOURNAL_ 1
+
+#include <vector>
+
+
+/**
+ * One change to a square of a Map
+ */
+struct MapChange
+{
+    enum Kind
+    {
+        Terrain, CreatureEnter, CreatureLeave, ItemPile
+    };
+
+    unsigned long version;    // version of the Map the change made
+    int           x;          // square changed
+    int           y;
+    Kind          kind;       // what changed there
+};
+
+
+/**
+ * ChangeJournal numbers changes as they are recorded and keeps the most
+ * recent of them in a ring of fixed size. Anyone keeping something up to
+ * date with a Map remembers the version they last saw, and asks for the
+ * changes since. If more changes than the ring holds have been made since
+ * then, they must start again from scratch.
+ */
+class ChangeJournal
+{
+public:
+    /**
+     * Create an empty journal
+     *
+     * @param capacity  number of changes to keep
+     */
+    explicit ChangeJournal(std::size_t capacity);
+
+    /**
+     * Record a change
+     *
+     * @param x         square changed
+     * @param y
+     * @param kind      what changed
+     * @return          version after the change
+     */
+    unsigned long record(int x, int y, MapChange::Kind kind);
+
+    /**
+     * Version after the last change. Starts at 0, and goes up by one for
+     * every change.
+     *
+     * @return          version
+     */
+    unsigned long getVersion() const { return m_version; }
+
+    /**
+     * Get the changes made after a version
+     *
+     * @param since     last version seen
+     * @param out       cleared, then filled with changes in order
+     * @return          false (and out left empty) if some are no longer kept
+     */
+    bool getChangesSince(unsigned long since, std::vector<MapChange> & out) const;
+
+private:
+    std::vector<MapChange> m_ring;
+    unsigned long m_version;
+};
+
+
+
+#endif
@@ -0,0 +1,105 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "chunkgrid.h"
+#include "error.h"
+
+//============================================================================
+// ChunkCache
+//============================================================================
+ChunkCache::ChunkCache() :
+    m_records(),
+    m_file(0),
+    m_end(0),
+    m_buffer()
+{
+}
+
+
+ChunkCache::~ChunkCache()
+{
+    if (m_file)
+        std::fclose(m_file);
+}
+
+
+// runs of up to 255 equal squares, each written as a count then the
+// square. Chunks are mostly long runs of one terrain, so this does well
+void
+ChunkCache::store(int chunk, void const *data, std::size_t count, std::size_t size)
+{
+    if (!m_file)
+    {
+        m_file = std::tmpfile();
+        if (!m_file)
+            throw Error<FileE>("Unable to create chunk cache file");
+    }
+
+    unsigned char const *in = static_cast<unsigned char const *>(data);
+    m_buffer.clear();
+    for (std::size_t i = 0; i < count; )
+    {
+        unsigned char const *square = in + i * size;
+        std::size_t run = 1;
+        while (i + run < count && run < 255 && std::memcmp(square + run * size, square, size) == 0)
+            ++run;
+        m_buffer.push_back(static_cast<unsigned char>(run));
+        m_buffer.insert(m_buffer.end(), square, square + size);
+        i += run;
+    }
+
+    // rewrite in place if the old copy has room, else append
+    Records::iterator it = m_records.find(chunk);
+    if (it == m_records.end() || it->second.room < m_buffer.size())
+    {
+        Record const rec = { m_end, 0, m_buffer.size() };
+        m_end += m_buffer.size();
+        if (it == m_records.end())
+            it = m_records.insert(Records::value_type(chunk, rec)).first;
+        else
+            it->second = rec;
+    }
+    it->second.length = m_buffer.size();
+
+    if (std::fseek(m_file, it->second.offset, SEEK_SET) != 0 ||
+        std::fwrite(&m_buffer[0], 1, m_buffer.size(), m_file) != m_buffer.size())
+        throw Error<FileE>("Unable to write chunk cache file");
+}
+
+
+bool
+ChunkCache::load(int chunk, void *data, std::size_t count, std::size_t size) const
+{
+    Records::const_iterator it = m_records.find(chunk);
+    if (it == m_records.end())
+        return false;
+
+    m_buffer.resize(it->second.length);
+    if (std::fseek(m_file, it->second.offset, SEEK_SET) != 0 ||
+        std::fread(&m_buffer[0], 1, m_buffer.size(), m_file) != m_buffer.size())
+        throw Error<FileE>("Unable to read chunk cache file");
+
+    unsigned char *out = static_cast<unsigned char *>(data);
+    std::size_t done = 0;
+    for (std::size_t i = 0; i + size < m_buffer.size() && done < count; i += size + 1)
+    {
+        std::size_t const run = std::min(std::size_t(m_buffer[i]), count - done);
+        for (std::size_t j = 0; j < run; ++j, ++done)
+            std::memcpy(out + done * size, &m_buffer[i + 1], size);
+    }
+    assert(done == count && "Chunk cache record is the wrong size");
+    return true;
+}
+
+
+void
+ChunkCache::clear()
+{
+    m_records.clear();
+    m_end = 0;
+}
@@ -0,0 +1,375 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#ifndef H_CHUNKGRID_
+#define H_CHUNKGRID_ 1
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <limits>
+#include <map>
+#include <vector>
+
+#include "boost/noncopyable.hpp"
+#include "boost/shared_ptr.hpp"
+
+#include "matrix2d.h"
+
+
+/**
+ * ChunkCache keeps chunks which have been pushed out of memory in a
+ * temporary file, run-length compressed. The file is only created once the
+ * first chunk is stored, and goes when the cache does.
+ */
+class ChunkCache : private boost::noncopyable
+{
+public:
+    ChunkCache();
+    ~ChunkCache();
+
+    /**
+     * Write a chunk out, replacing any earlier copy
+     *
+     * @param chunk  chunk number
+     * @param data   contents
+     * @param count  number of squares
+     * @param size   size of each square
+     */
+    void store(int chunk, void const *data, std::size_t count, std::size_t size);
+
+    /**
+     * Read a chunk back in
+     *
+     * @param chunk  chunk number
+     * @param data   filled with contents
+     * @param count  number of squares
+     * @param size   size of each square
+     * @return       false if the chunk was never stored
+     */
+    bool load(int chunk, void *data, std::size_t count, std::size_t size) const;
+
+    /**
+     * Drop every stored chunk
+     */
+    void clear();
+
+    /**
+     * Size of the compressed chunks on disk, live or superseded
+     *
+     * @return       bytes
+     */
+    long getFileBytes() const { return m_end; }
+
+private:
+    struct Record
+    {
+        long        offset;
+        std::size_t length;
+        std::size_t room;
+    };
+    typedef std::map<int, Record> Records;
+
+    Records m_records;
+    std::FILE *m_file;
+    long m_end;
+    mutable std::vector<unsigned char> m_buffer;
+};
+
+
+/**
+ * Generates the contents of chunks of a ChunkedGrid nobody has written to,
+ * so they need never be kept in memory or on disk until changed. The same
+ * chunk must always come out the same.
+ */
+template<typename T>
+class ChunkSource
+{
+public:
+    virtual ~ChunkSource() {}
+
+    /**
+     * Fill a chunk
+     *
+     * @param x0     x-coordinate of the chunk's top left square
+     * @param y0     y-coordinate of the chunk's top left square
+     * @param w      squares across (less than ChunkSide on the right edge)
+     * @param h      squares down (less than ChunkSide on the bottom edge)
+     * @param out    ChunkSide * ChunkSide squares, row by row
+     */
+    virtual void generate(int x0, int y0, int w, int h, T *out) const = 0;
+};
+
+
+/**
+ * ChunkedGrid holds one T per square of a grid in square chunks, each only
+ * allocated when first touched. Until then a chunk reads as the fill value,
+ * or whatever its ChunkSource generates. Chunks not used lately can be
+ * evicted: one nobody has written to is simply dropped and generated again
+ * when next wanted, while one which has been written to goes to the
+ * ChunkCache. Squares within a chunk are arranged by Layout, as for
+ * Matrix2D. T must be plain old data.
+ */
+template<typename T, typename Layout = RowMajorLayout>
+class ChunkedGrid : private boost::noncopyable
+{
+public:
+    enum
+    {
+        ChunkShift = 6,
+        ChunkSide = 1 << ChunkShift,
+        ChunkSquares = ChunkSide * ChunkSide
+    };
+
+    typedef boost::shared_ptr<ChunkSource<T> const> SourceH;
+
+    /**
+     * Create a grid with every square set to fill
+     *
+     * @param x      width of grid
+     * @param y      height of grid
+     * @param fill   value of squares of untouched chunks
+     */
+    ChunkedGrid(int x, int y, T fill);
+
+    /**
+     * Get one square, bringing its chunk into memory if there is anything
+     * other than the fill value to read
+     *
+     * @param x      x-coordinate, inside grid
+     * @param y      y-coordinate, inside grid
+     * @return       value of square
+     */
+    T get(int x, int y) const
+    {
+        Chunk const & ch = m_chunks[chunkOf(x, y)];
+        if (ch.data.empty())
+        {
+            if (!m_source && !ch.stored)
+                return m_fill;
+            fetch(chunkOf(x, y));
+        }
+        ch.used = ++m_clock;
+        return ch.data[squareOf(x, y)];
+    }
+
+    /**
+     * Set one square
+     *
+     * @param x      x-coordinate, inside grid
+     * @param y      y-coordinate, inside grid
+     * @param v      new value
+     */
+    void set(int x, int y, T v)
+    {
+        int const c = chunkOf(x, y);
+        Chunk & ch = m_chunks[c];
+        if (ch.data.empty())
+            fetch(c);
+        ch.used = ++m_clock;
+        ch.dirty = true;
+        ch.data[squareOf(x, y)] = v;
+    }
+
+    /**
+     * Generate chunks from src from now on. Every chunk is reset.
+     *
+     * @param src    source, or an empty handle for the fill value
+     */
+    void setSource(SourceH src);
+
+    /**
+     * Put every square back to the fill value (or source), freeing all
+     * chunks
+     */
+    void clear();
+
+    /**
+     * Evict all but the most recently used chunks
+     *
+     * @param keep   number of chunks to leave in memory
+     * @return       number of chunks evicted
+     */
+    std::size_t evict(std::size_t keep);
+
+    /**
+     * Number of chunks held in memory
+     *
+     * @return       chunks
+     */
+    std::size_t getResidentChunks() const { return m_resident; }
+
+    /**
+     * Memory held by the chunks in memory, not counting bookkeeping
+     *
+     * @return       bytes
+     */
+    long getResidentBytes() const { return static_cast<long>(m_resident) * ChunkSide * ChunkSide * sizeof(T); }
+
+    /**
+     * Number of chunks making up the grid
+     *
+     * @return       chunks
+     */
+    std::size_t getChunkCount() const { return m_chunks.size(); }
+
+    /**
+     * Size of the evicted chunk file
+     *
+     * @return       bytes
+     */
+    long getCacheBytes() const { return m_cache.getFileBytes(); }
+
+    int getWidth() const { return m_xsize; }
+    int getHeight() const { return m_ysize; }
+
+private:
+    struct Chunk
+    {
+        Chunk() : data(), used(0), dirty(false), stored(false) {}
+
+        std::vector<T>        data;     // empty unless resident
+        mutable unsigned long used;     // clock when last read or written
+        bool                  dirty;    // written since last generated or stored
+        bool                  stored;   // has a copy in the cache
+    };
+
+    int chunkOf(int x, int y) const
+    {
+        assert(x >= 0 && y >= 0 && x < m_xsize && y < m_ysize);
+        return (y >> ChunkShift) * m_chunks_x + (x >> ChunkShift);
+    }
+
+    int squareOf(int x, int y) const
+    {
+        return m_layout.index(x & (ChunkSide - 1), y & (ChunkSide - 1));
+    }
+
+    void fetch(int c) const;
+
+    Layout m_layout;
+    mutable std::vector<Chunk> m_chunks;
+    mutable std::vector<T> m_generated;
+    mutable std::size_t m_resident;
+    mutable unsigned long m_clock;
+    ChunkCache m_cache;
+    SourceH m_source;
+    T m_fill;
+    int m_xsize;
+    int m_ysize;
+    int m_chunks_x;
+};
+
+
+template<typename T, typename Layout>
+ChunkedGrid<T, Layout>::ChunkedGrid(int x, int y, T fill) :
+    m_layout(ChunkSide, ChunkSide),
+    m_chunks(((x + ChunkSide - 1) >> ChunkShift) * ((y + ChunkSide - 1) >> ChunkShift)),
+    m_generated(),
+    m_resident(0),
+    m_clock(0),
+    m_cache(),
+    m_source(),
+    m_fill(fill),
+    m_xsize(x),
+    m_ysize(y),
+    m_chunks_x((x + ChunkSide - 1) >> ChunkShift)
+{
+}
+
+
+template<typename T, typename Layout>
+void
+ChunkedGrid<T, Layout>::fetch(int c) const
+{
+    Chunk & ch = m_chunks[c];
+    ch.data.assign(m_layout.size(), m_fill);
+    ++m_resident;
+    if (ch.stored)
+    {
+        m_cache.load(c, &ch.data[0], ch.data.size(), sizeof(T));
+    }
+    else if (m_source)
+    {
+        int const x0 = (c % m_chunks_x) << ChunkShift;
+        int const y0 = (c / m_chunks_x) << ChunkShift;
+        int const w = std::min(int(ChunkSide), m_xsize - x0);
+        int const h = std::min(int(ChunkSide), m_ysize - y0);
+
+        // sources write rows, which then go where the layout wants them
+        m_generated.assign(ChunkSquares, m_fill);
+        m_source->generate(x0, y0, w, h, &m_generated[0]);
+        for (int y = 0; y < h; ++y)
+            for (int x = 0; x < w; ++x)
+                ch.data[m_layout.index(x, y)] = m_generated[(y << ChunkShift) + x];
+    }
+}
+
+
+template<typename T, typename Layout>
+void
+ChunkedGrid<T, Layout>::setSource(SourceH src)
+{
+    m_source = src;
+    clear();
+}
+
+
+template<typename T, typename Layout>
+void
+ChunkedGrid<T, Layout>::clear()
+{
+    for (typename std::vector<Chunk>::iterator it = m_chunks.begin(); it != m_chunks.end(); ++it)
+    {
+        std::vector<T>().swap(it->data);
+        it->dirty = false;
+        it->stored = false;
+    }
+    m_resident = 0;
+    m_cache.clear();
+}
+
+
+template<typename T, typename Layout>
+std::size_t
+ChunkedGrid<T, Layout>::evict(std::size_t keep)
+{
+    if (m_resident <= keep)
+        return 0;
+
+    // find the clock of the oldest chunk to keep
+    std::vector<unsigned long> ages;
+    ages.reserve(m_resident);
+    for (typename std::vector<Chunk>::const_iterator it = m_chunks.begin(); it != m_chunks.end(); ++it)
+        if (!it->data.empty())
+            ages.push_back(it->used);
+    unsigned long cutoff = std::numeric_limits<unsigned long>::max();
+    if (keep)
+    {
+        std::nth_element(ages.begin(), ages.end() - keep, ages.end());
+        cutoff = *(ages.end() - keep);
+    }
+
+    std::size_t evicted = 0;
+    for (std::size_t c = 0; c < m_chunks.size(); ++c)
+    {
+        Chunk & ch = m_chunks[c];
+        if (ch.data.empty() || ch.used >= cutoff)
+            continue;
+        if (ch.dirty)
+        {
+            m_cache.store(c, &ch.data[0], ch.data.size(), sizeof(T));
+            ch.stored = true;
+            ch.dirty = false;
+        }
+        std::vector<T>().swap(ch.data);
+        --m_resident;
+        ++evicted;
+    }
+    return evicted;
+}
+
+
+
+#endif
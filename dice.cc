@@ -10,6 +10,8 @@
 #include <queue>
 #include <utility>
 
+#include "boost/thread/tss.hpp"
+
 #include "dice.h"
 
 
@@ -29,6 +31,23 @@ namespace
         return gldice;
     }
 
+    // Streams are borrowed, never owned, so there's nothing to clean up
+    void KeepStream(Dice *)
+    {
+    }
+
+    boost::thread_specific_ptr<Dice> & currentStream()
+    {
+        static boost::thread_specific_ptr<Dice> current(&KeepStream);
+        return current;
+    }
+
+    Dice & activeDice()
+    {
+        Dice *dice = currentStream().get();
+        return dice ? *dice : globalDice();
+    }
+
     int ParseNumber(char const * & ptr)
     {
         int num = 0;
@@ -103,7 +122,7 @@ int
 Dice::Random0(int mmax)
 {
     static int const imax = std::numeric_limits<int>::max();
-    return mmax > 0 ? std::abs(globalDice().rnd() / (imax / mmax + 1)) : 0;
+    return mmax > 0 ? std::abs(activeDice().rnd() / (imax / mmax + 1)) : 0;
 }
 
 
@@ -234,3 +253,18 @@ Dice::rnd()
 }
 
 
+
+//============================================================================
+// Dice::Stream
+//============================================================================
+Dice::Stream::Stream(Dice & dice) :
+    m_previous(currentStream().get())
+{
+    currentStream().reset(&dice);
+}
+
+
+Dice::Stream::~Stream()
+{
+    currentStream().reset(m_previous);
+}
@@ -75,6 +75,21 @@ public:
      */
     int rnd();
 
+    /**
+     * While a Stream exists, Random0() and Random() called on the same
+     * thread draw from its Dice rather than the global PRNG. Streams nest;
+     * the previous one is restored on destruction.
+     */
+    class Stream : boost::noncopyable
+    {
+    public:
+        explicit Stream(Dice & dice);
+        ~Stream();
+
+    private:
+        Dice * m_previous;
+    };
+
 
 private:
     boost::mt19937 m_rng;
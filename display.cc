@@ -16,9 +16,11 @@
 #include "display.h"
 #include "error.h"
 #include "fov.h"
+#include "fovcache.h"
 #include "hero.h"
 #include "item.h"
 #include "option.h"
+#include "shadowcast.h"
 #include "textutils.h"
 
  //============================================================================
@@ -205,7 +207,7 @@ namespace
     void HeroLightCell(void *mp, int x, int y, int /*dx*/, int /*dy*/, void * /*src*/)
     {
         Map *mymap = static_cast<Map *>(mp);
-        Coords mapsize = mymap->getSize();
+        Point mapsize = mymap->getSize();
 
         if (x >= 0 && y >= 0 && x < mapsize.X() && y < mapsize.Y())
         {
@@ -214,13 +216,11 @@ namespace
         }
     }
 
-    bool HeroIsNotOpaque(void *mp, int x, int y)
+    // libfov's opacity test answers "is this square opaque?", just as
+    // ShadowCast's does, so both go through OpaquePlane
+    bool HeroIsOpaque(void *mp, int x, int y)
     {
-        Map *mymap = static_cast<Map *>(mp);
-        Coords mapsize = mymap->getSize();
-        if (x < 0 || y < 0 || x >= mapsize.X() || y >= mapsize.Y())
-            return false;
-        return !mymap->blocksVision(Coords(x, y), HERO);
+        return OpaquePlane(static_cast<Map *>(mp)->getOpaquePlane())(x, y);
     }
 
 }
@@ -229,6 +229,7 @@ namespace
 
 Display::Display(OptionH opt) :
     m_fov_settings(new fov_settings_type, DeleteFOVSettings),
+    m_fov_cache(new FOVCache),
     m_actionlookup(new ActionLookup)
 {
     using namespace Actions;
@@ -265,7 +266,7 @@ Display::Display(OptionH opt) :
     fov_settings_set_shape(m_fov_settings.get(), FOV_SHAPE_OCTAGON);
     fov_settings_set_corner_peek(m_fov_settings.get(), FOV_CORNER_NOPEEK);
     fov_settings_set_opaque_apply(m_fov_settings.get(), FOV_OPAQUE_APPLY);
-    fov_settings_set_opacity_test_function(m_fov_settings.get(), HeroIsNotOpaque);
+    fov_settings_set_opacity_test_function(m_fov_settings.get(), HeroIsOpaque);
     fov_settings_set_apply_lighting_function(m_fov_settings.get(), HeroLightCell);
 }
 
@@ -434,7 +435,6 @@ Display::drawMap()
 {
     Coords mypos = HERO->getCoords();
     MapH mymap = mypos.M();
-    Coords mapsize = mymap->getSize();
 
     Coords vis_size = getMainMapSize();
     Coords vis_ctr = Coords((vis_size.X() + 1) / 2, (vis_size.Y() + 1) / 2);
@@ -443,8 +443,18 @@ Display::drawMap()
         sightradius = std::min(vis_ctr.X(), vis_ctr.Y());
 
     mymap->clearSeenGrid();
+#ifdef DISPLAY_LIBFOV
     fov_circle(m_fov_settings.get(), mymap.get(), &HERO, mypos.X(), mypos.Y(), sightradius);
     HeroLightCell(mymap.get(), mypos.X(), mypos.Y(), 0, 0, &HERO);
+#else
+    // only shadowcasts when the hero has moved or the walls nearby changed
+    std::vector<Point> const & seen = m_fov_cache->getVisible(*mymap, mypos, sightradius);
+    for (std::vector<Point>::const_iterator it = seen.begin(); it != seen.end(); ++it)
+    {
+        mymap->setSeenGrid(it->X(), it->Y(), Map::Lit);
+        mymap->setHeroSeenChar(it->X(), it->Y());
+    }
+#endif
     drawCellsToMap(mymap, mypos.X() - sightradius, mypos.Y() - sightradius,
                    1 + 2 * sightradius, 1 + 2 * sightradius);
 }
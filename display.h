@@ -19,6 +19,7 @@
 
 
 struct fov_settings_type;
+class FOVCache;
 
 
 /**
@@ -235,9 +236,12 @@ private:
      */
     int getAction(Actions::Mode mode);
 
+    // libfov, kept for comparison with ShadowCast. Used to draw the map
+    // when built with DISPLAY_LIBFOV
     typedef boost::shared_ptr<fov_settings_type> FOVSettings;
 
     FOVSettings                     m_fov_settings;
+    boost::shared_ptr<FOVCache>     m_fov_cache;
     boost::shared_ptr<ActionLookup> m_actionlookup;
 };
 
@@ -5,8 +5,11 @@
 #include <algorithm>
 #include <cassert>
 
+#include "creature.h"
+#include "dice.h"
 #include "dungeonmaster.h"
 #include "map.h"
+#include "monster.h"
 #include "stllike.h"
 
 //============================================================================
@@ -15,7 +18,11 @@
 DungeonMaster::DungeonMaster(std::string name) :
     Actor(),
     m_name(name),
-    m_maps()
+    m_maps(),
+    m_level_x(80),
+    m_level_y(80),
+    m_spawn_interval(0),
+    m_spawn_cap(0)
 {
 }
 
@@ -32,6 +39,15 @@ DungeonMaster::getName() const
 }
 
 
+void
+DungeonMaster::setLevelSize(int x, int y)
+{
+    assert(x > 0 && y > 0 && "Illegal level size submitted to setLevelSize()");
+    m_level_x = x;
+    m_level_y = y;
+}
+
+
 MapH
 DungeonMaster::getOrCreateMap(int mp)
 {
@@ -40,7 +56,7 @@ DungeonMaster::getOrCreateMap(int mp)
     if (mp >= static_cast<int>(m_maps.size()))
         m_maps.resize(mp + 1);
     if (m_maps[mp].get() == 0)
-        m_maps[mp] = createLevel(mp, 80, 80);
+        m_maps[mp] = createLevel(mp, m_level_x, m_level_y);
 
     return m_maps[mp];
 }
@@ -49,6 +65,68 @@ DungeonMaster::getOrCreateMap(int mp)
 
 
 
+int
+DungeonMaster::findLevel(Map const * mp) const
+{
+    for (MapList::const_iterator it = m_maps.begin(); it != m_maps.end(); ++it)
+        if (it->get() == mp)
+            return static_cast<int>(it - m_maps.begin());
+    return -1;
+}
+
+
+void
+DungeonMaster::setAbstractSpawning(unsigned int interval, int cap)
+{
+    m_spawn_interval = interval;
+    m_spawn_cap = cap;
+}
+
+
+void
+DungeonMaster::simulateAbstract(MapH mp, unsigned int turns)
+{
+    Dice::Stream stream(mp->getDice());
+    Point const size = mp->getSize();
+    std::vector<CreatureH> creatures;
+    mp->getCreatures(creatures);
+
+    // a random walk of n steps ends about sqrt(n) away. Try a few squares
+    // that far out; if they're all blocked the creature stays put
+    for (std::vector<CreatureH>::iterator it = creatures.begin(); it != creatures.end(); ++it)
+    {
+        if ((*it)->heroGUID())
+            continue;
+        int const steps = turns / (*it)->getSpeed();
+        int radius = 0;
+        while ((radius + 1) * (radius + 1) <= steps)
+            ++radius;
+        if (radius == 0)
+            continue;
+
+        Point const here = (*it)->getCoords();
+        for (int tries = 0; tries < 4; ++tries)
+        {
+            Point const step(Dice::Random0(2 * radius + 1) - radius, Dice::Random0(2 * radius + 1) - radius);
+            Point const there = here + step;
+            if (!size.containsPoint(there) || !mp->isPassable(there, *it) || mp->getCreature(there))
+                continue;
+            mp->moveCreature(there, *it);
+            break;
+        }
+    }
+
+    if (m_spawn_interval == 0)
+        return;
+    int spawns = turns / m_spawn_interval;
+    if (Dice::Random0(m_spawn_interval) < static_cast<int>(turns % m_spawn_interval))
+        ++spawns;
+    for (int num = static_cast<int>(creatures.size()); spawns && num < m_spawn_cap; --spawns, ++num)
+        if (!mp->addCreature(Map::Random, Monster::createMonster(Species::Human)))
+            break;
+}
+
+
 unsigned int
 DungeonMaster::act()
 {
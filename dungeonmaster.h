@@ -43,6 +43,41 @@ public:
      */
     std::string const & getName() const;
 
+    /**
+     * Set the size of levels created from now on
+     *
+     * @param x            width of new levels
+     * @param y            height of new levels
+     */
+    void setLevelSize(int x, int y);
+
+    /**
+     * Find which of this DM's levels a Map is
+     *
+     * @param mp           map to look for
+     * @return             level, or -1 if the map isn't this DM's
+     */
+    int findLevel(Map const * mp) const;
+
+    /**
+     * Advance a level far from any hero by a large span of time, without
+     * letting each Actor act. Creatures are scattered about as far as a
+     * random walk of their speed would take them, and new monsters are
+     * spawned at the rate set by setAbstractSpawning().
+     *
+     * @param mp           one of this DM's maps
+     * @param turns        ticks of time to pass
+     */
+    virtual void simulateAbstract(MapH mp, unsigned int turns);
+
+    /**
+     * Set how simulateAbstract() spawns monsters
+     *
+     * @param interval     mean ticks between spawns, 0 for none
+     * @param cap          no spawning once a level holds this many creatures
+     */
+    void setAbstractSpawning(unsigned int interval, int cap);
+
 
 
     // From Actor
@@ -84,6 +119,10 @@ private:
 
     std::string    m_name;
     MapList        m_maps;
+    int            m_level_x;
+    int            m_level_y;
+    unsigned int   m_spawn_interval;
+    int            m_spawn_cap;
 };
 
 
@@ -8,6 +8,7 @@
 
 #include <sstream>
 #include <stdexcept>
+#include <string>
 
 #include "boost/shared_ptr.hpp"
 
@@ -17,12 +18,14 @@ template<class T>
 class Error : public std::exception
 {
     boost::shared_ptr<std::ostringstream> m_err;
+    mutable std::string m_what;     // what() must outlive its call
 
 public:
     Error(char const *msg = "")
     :   std::exception(),
         m_err(new std::ostringstream(msg, std::ios_base::app |
-                                     std::ios_base::ate | std::ios_base::out))
+                                     std::ios_base::ate | std::ios_base::out)),
+        m_what()
     {
     }
 
@@ -32,7 +35,8 @@ public:
 
     virtual char const * what() const throw()
     {
-        return m_err->str().c_str();
+        m_what = m_err->str();
+        return m_what.c_str();
     }
 
     template<typename U>
@@ -64,4 +68,8 @@ struct CommsE
 {
 };
 
+struct ThreadE
+{
+};
+
 #endif
@@ -0,0 +1,99 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#include <cstdlib>
+
+#include "fovcache.h"
+#include "map.h"
+#include "shadowcast.h"
+
+
+namespace
+{
+    // ShadowCast lighting which lists the squares seen
+    struct ListSquares
+    {
+        ListSquares(std::vector<Point> & o, Point size) :
+            out(o), width(size.X()), height(size.Y()) {}
+
+        void operator()(int x, int y)
+        {
+            if (x >= 0 && y >= 0 && x < width && y < height)
+                out.push_back(Point(x, y));
+        }
+
+        std::vector<Point> & out;
+        int width;
+        int height;
+    };
+}
+
+
+//============================================================================
+// FOVCache
+//============================================================================
+FOVCache::FOVCache() :
+    m_valid(false),
+    m_map(0),
+    m_origin(),
+    m_radius(0),
+    m_version(0),
+    m_visible(),
+    m_changes(),
+    m_casts(0),
+    m_hits(0)
+{
+}
+
+
+std::vector<Point> const &
+FOVCache::getVisible(Map const & mp, Point origin, int radius)
+{
+    if (stillValid(mp, origin, radius))
+    {
+        ++m_hits;
+        return m_visible;
+    }
+
+    m_visible.clear();
+    ListSquares list(m_visible, mp.getSize());
+    ShadowCast(OpaquePlane(mp.getOpaquePlane()), list, origin.X(), origin.Y(), radius);
+
+    m_valid = true;
+    m_map = mp.getId();
+    m_origin = origin;
+    m_radius = radius;
+    m_version = mp.getVersion();
+    ++m_casts;
+    return m_visible;
+}
+
+
+void
+FOVCache::clear()
+{
+    m_valid = false;
+    m_visible.clear();
+}
+
+
+bool
+FOVCache::stillValid(Map const & mp, Point origin, int radius)
+{
+    if (!m_valid || mp.getId() != m_map || !(origin == m_origin) || radius != m_radius)
+        return false;
+    if (mp.getVersion() == m_version)
+        return true;
+
+    // too many changes to have kept them all is as good as a change nearby
+    if (!mp.getChangesSince(m_version, m_changes))
+        return false;
+    for (std::vector<MapChange>::const_iterator it = m_changes.begin(); it != m_changes.end(); ++it)
+        if (it->kind == MapChange::Terrain && std::abs(it->x - origin.X()) <= radius &&
+            std::abs(it->y - origin.Y()) <= radius)
+            return false;
+
+    m_version = mp.getVersion();
+    return true;
+}
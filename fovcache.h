@@ -0,0 +1,77 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#ifndef H_FOVCACHE_
+#define H_FOVCACHE_ 1
+
+#include <vector>
+
+#include "boost/noncopyable.hpp"
+
+#include "changejournal.h"
+#include "handles.h"
+
+class Map;
+
+
+/**
+ * FOVCache remembers the squares seen from the last square it was asked
+ * about. It is keyed on the Map, the viewpoint, the radius and the Map's
+ * version, and asks the Map's change journal what has changed since
+ * rather than shadowcasting again. Only a change of terrain within the
+ * radius can change what is seen, so any other change (creatures moving,
+ * items dropped, terrain far away) leaves the squares cached.
+ */
+class FOVCache : private boost::noncopyable
+{
+public:
+    FOVCache();
+
+    /**
+     * Get the squares seen from a square, shadowcasting only if something
+     * which could change them has happened since last asked
+     *
+     * @param mp     map
+     * @param origin viewpoint, which is seen itself
+     * @param radius how far can be seen
+     * @return       squares seen, valid until the next call
+     */
+    std::vector<Point> const & getVisible(Map const & mp, Point origin, int radius);
+
+    /**
+     * Forget the squares cached, so the next call shadowcasts
+     */
+    void clear();
+
+    /**
+     * Number of calls which shadowcast
+     *
+     * @return       casts
+     */
+    unsigned long getCasts() const { return m_casts; }
+
+    /**
+     * Number of calls answered from the cache
+     *
+     * @return       hits
+     */
+    unsigned long getHits() const { return m_hits; }
+
+private:
+    bool stillValid(Map const & mp, Point origin, int radius);
+
+    bool m_valid;
+    MapId m_map;
+    Point m_origin;
+    int m_radius;
+    unsigned long m_version;
+    std::vector<Point> m_visible;
+    std::vector<MapChange> m_changes;
+    unsigned long m_casts;
+    unsigned long m_hits;
+};
+
+
+
+#endif
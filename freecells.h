@@ -0,0 +1,157 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#ifndef H_FREECELLS_
+#define H_FREECELLS_ 1
+
+#include <vector>
+
+#include "boost/cstdint.hpp"
+#include "boost/noncopyable.hpp"
+
+
+/**
+ * FreeCells is a set of the squares of a grid, kept as one bit per square
+ * with a count of the squares in each block of words, so the n-th square
+ * (and so one at random) is found by skipping whole blocks, then whole
+ * words, rather than looking at every square.
+ *
+ * Squares are addressed by index, y * width + x.
+ */
+class FreeCells : private boost::noncopyable
+{
+public:
+    /**
+     * Create an empty set
+     *
+     * @param squares  number of squares in grid
+     */
+    explicit FreeCells(int squares) :
+        m_words((squares + WordBits - 1) / WordBits, 0),
+        m_blocks((m_words.size() + BlockWords - 1) / BlockWords, 0),
+        m_size(0) {}
+
+    /**
+     * Is a square in the set?
+     *
+     * @param index    square
+     * @return         true if present
+     */
+    bool contains(int index) const { return (m_words[index / WordBits] >> (index % WordBits)) & 1; }
+
+    /**
+     * Add a square, if not already present
+     *
+     * @param index    square
+     */
+    void insert(int index)
+    {
+        Word & word = m_words[index / WordBits];
+        Word const bit = Word(1) << (index % WordBits);
+        if (word & bit)
+            return;
+        word |= bit;
+        ++m_blocks[index / (WordBits * BlockWords)];
+        ++m_size;
+    }
+
+    /**
+     * Remove a square, if present
+     *
+     * @param index    square
+     */
+    void remove(int index)
+    {
+        Word & word = m_words[index / WordBits];
+        Word const bit = Word(1) << (index % WordBits);
+        if (!(word & bit))
+            return;
+        word &= ~bit;
+        --m_blocks[index / (WordBits * BlockWords)];
+        --m_size;
+    }
+
+    /**
+     * Add or remove a square
+     *
+     * @param index    square
+     * @param free     true to add
+     */
+    void set(int index, bool free)
+    {
+        if (free)
+            insert(index);
+        else
+            remove(index);
+    }
+
+    /**
+     * Number of squares in the set
+     *
+     * @return         squares
+     */
+    std::size_t size() const { return m_size; }
+
+    /**
+     * Is the set empty?
+     *
+     * @return         true if no squares
+     */
+    bool empty() const { return m_size == 0; }
+
+    /**
+     * A square of the set, counting up by index
+     *
+     * @param n        0 to size() - 1
+     * @return         square
+     */
+    int get(std::size_t n) const;
+
+private:
+    typedef boost::uint64_t Word;
+
+    enum
+    {
+        WordBits = 64,
+        BlockWords = 64
+    };
+
+    // number of bits set
+    static int Count(Word w)
+    {
+        w -= (w >> 1) & (~Word(0) / 3);
+        w = (w & (~Word(0) / 5)) + ((w >> 2) & (~Word(0) / 5));
+        w = (w + (w >> 4)) & (~Word(0) / 17);
+        return static_cast<int>((w * (~Word(0) / 255)) >> 56);
+    }
+
+    std::vector<Word> m_words;
+    std::vector<int>  m_blocks;     // squares in each BlockWords words
+    std::size_t       m_size;
+};
+
+
+inline int
+FreeCells::get(std::size_t n) const
+{
+    std::size_t block = 0;
+    while (n >= std::size_t(m_blocks[block]))
+        n -= m_blocks[block++];
+
+    std::size_t w = block * BlockWords;
+    while (n >= std::size_t(Count(m_words[w])))
+        n -= Count(m_words[w++]);
+
+    // drop the n lowest squares of the word, then find the lowest left
+    Word word = m_words[w];
+    for (; n > 0; --n)
+        word &= word - 1;
+    int bit = 0;
+    while (!((word >> bit) & 1))
+        ++bit;
+    return static_cast<int>(w * WordBits) + bit;
+}
+
+
+#endif
@@ -151,31 +151,63 @@ extern OptionH OPTION;
 //============================================================================
 
 /**
- * Coords represent coordinates or locations on a map
+ * Point is a bare position, with nothing to say which map it is on. It is
+ * eight bytes and trivially copyable, so it is what Map, path finding and
+ * line tracing take and hand back for squares of a single map.
  */
-class Coords
+class Point
 {
     friend class Map;
-    MapH setMap(MapH mp) { MapH tmp(m); m = mp; return tmp; }
 
+protected:
     int x;
     int y;
-    MapH m;
 
 public:
-    Coords(int xx, int yy) : x(xx), y(yy), m() {}
-    Coords() : x(-1), y(-1), m() {}
+    Point(int xx, int yy) : x(xx), y(yy) {}
+    Point() : x(-1), y(-1) {}
     int X() const { return x; }
     int Y() const { return y; }
+    bool containsPoint(Point const & rhs) const { return rhs.x >= 0 && rhs.x < x && rhs.y >= 0 && rhs.y < y; }
+    bool operator<(Point const & rh) const { return y < rh.y || (y == rh.y && x < rh.x); }
+    bool operator==(Point const & rh) const { return x == rh.x && y == rh.y; }
+    bool operator!=(Point const & rh) const { return !(*this == rh); }
+    Point & operator+=(Point const & rh)     { x += rh.x; y += rh.y; return *this; }
+    Point & operator-=(Point const & rh)     { x -= rh.x; y -= rh.y; return *this; }
+    Point operator+(Point const & r) const   { Point c(*this); return c += r; }
+    Point operator-(Point const & r) const   { Point c(*this); return c -= r; }
+};
+
+
+/**
+ * Identifies a Map without holding on to it
+ */
+typedef unsigned int MapId;
+
+
+/**
+ * Coords represent a location: a Point and the map it is on. Holding the
+ * map costs a reference count on every copy, so Coords are only used where
+ * a location may be on any map, as for where an Actor is. They convert to
+ * Point wherever only the square is wanted.
+ */
+class Coords : public Point
+{
+    friend class Map;
+
+    MapH m;
+
+public:
+    Coords(int xx, int yy) : Point(xx, yy), m() {}
+    Coords() : Point(), m() {}
+    Coords(Point p, MapH mp) : Point(p), m(mp) {}
     MapH M() const { return m; }
-    bool containsPoint(Coords const & rhs) const { return rhs.x >= 0 && rhs.x < x && rhs.y >= 0 && rhs.y < y; }
-    bool operator<(Coords const & rh) const { return long(y) * 1024 + x < long(rh.y) * 1024 + rh.x; }
     bool operator==(Coords const & rh) const { return m == rh.m && x == rh.x && y == rh.y; }
     bool operator!=(Coords const & rh) const { return !(*this == rh); }
-    Coords & operator+=(Coords const & rh)   { x += rh.x; y += rh.y; return *this; }
-    Coords & operator-=(Coords const & rh)   { x -= rh.x; y -= rh.y; return *this; }
-    Coords operator+(Coords const & r) const { Coords c(*this); return c += r; }
-    Coords operator-(Coords const & r) const { Coords c(*this); return c -= r; }
+    Coords & operator+=(Point const & rh)    { x += rh.X(); y += rh.Y(); return *this; }
+    Coords & operator-=(Point const & rh)    { x -= rh.X(); y -= rh.Y(); return *this; }
+    Coords operator+(Point const & r) const  { Coords c(*this); return c += r; }
+    Coords operator-(Point const & r) const  { Coords c(*this); return c -= r; }
 };
 
 
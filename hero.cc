@@ -459,7 +459,7 @@ Hero::doPickUpFromGround(int)
             }
             char alpha = (char)succ.second->getEffect(ItemEffect::AlphaIndex).edata1;
             out << alpha << " - " << itemname;
-            items->delItem(*it);
+            mymap->delItem(mypos, *it);
             ++time_taken;
         }
         else
@@ -531,7 +531,7 @@ Hero::doDrop(ItemPicker::Selected & picked)
 
     Coords mypos = getCoords();
     MapH mymap = mypos.M();
-    ItemPileH items = mymap->getItemPile(mypos);
+    ItemPileH items = mymap->openItemPile(mypos);
     ItemPileH inventory = getInventory();
     std::ostringstream out;
     unsigned int time_taken = 1U;
@@ -595,6 +595,7 @@ Hero::doDrop(ItemPicker::Selected & picked)
             break;
         }
     }
+    mymap->reclaimItemPile(mypos);
     out << '.';
     DISPLAY->printMessage(out.str());
     DISPLAY->render();
@@ -0,0 +1,213 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "lightmap.h"
+#include "map.h"
+#include "shadowcast.h"
+
+
+namespace
+{
+    // ShadowCast lighting filling in a source's footprint, brightest at
+    // the source and fading with the square of the distance. Squares are
+    // red, green, blue and padding, as LightMap keeps them
+    struct Footprint
+    {
+        Footprint(boost::uint16_t *f, Point c, int r, int const *rgb, Point size) :
+            out(f), centre(c), radius(r), fade((r + 1) * (r + 1)), colour(rgb),
+            width(size.X()), height(size.Y()) {}
+
+        void operator()(int x, int y)
+        {
+            if (x < 0 || y < 0 || x >= width || y >= height)
+                return;
+            int const dx = x - centre.X();
+            int const dy = y - centre.Y();
+            int const left = fade - dx * dx - dy * dy;
+            if (left <= 0)
+                return;
+            boost::uint16_t *square = out + 4 * ((dy + radius) * (2 * radius + 1) + dx + radius);
+            for (int c = 0; c < 3; ++c)
+                square[c] = static_cast<boost::uint16_t>(colour[c] * left / fade);
+        }
+
+        boost::uint16_t *out;
+        Point centre;
+        int radius;
+        int fade;
+        int const *colour;
+        int width;
+        int height;
+    };
+
+    // add a row of squares, saturating at the top of the range
+    void AddRow(boost::uint16_t *to, boost::uint16_t const *from, int levels)
+    {
+        int i = 0;
+#ifdef __SSE2__
+        for (; i + 8 <= levels; i += 8)
+        {
+            __m128i const a = _mm_loadu_si128(reinterpret_cast<__m128i const *>(to + i));
+            __m128i const b = _mm_loadu_si128(reinterpret_cast<__m128i const *>(from + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(to + i), _mm_adds_epu16(a, b));
+        }
+#endif
+        for (; i < levels; ++i)
+            to[i] = static_cast<boost::uint16_t>(std::min(0xffff, to[i] + from[i]));
+    }
+}
+
+
+//============================================================================
+// LightMap
+//============================================================================
+LightMap::LightMap(int x, int y) :
+    m_sources(),
+    m_free(),
+    m_sum(Channels * x * y, 0),
+    m_resum(false),
+    m_map(0),
+    m_version(0),
+    m_changes(),
+    m_casts(0),
+    m_xsize(x),
+    m_ysize(y)
+{
+}
+
+
+LightMap::SourceId
+LightMap::addSource(Point at, int radius, int red, int green, int blue)
+{
+    assert(radius >= 0);
+    SourceId id;
+    if (m_free.empty())
+    {
+        id = static_cast<SourceId>(m_sources.size());
+        m_sources.push_back(Source());
+    }
+    else
+    {
+        id = m_free.back();
+        m_free.pop_back();
+    }
+
+    Source & src = m_sources[id];
+    src.at = at;
+    src.radius = radius;
+    src.colour[0] = red;
+    src.colour[1] = green;
+    src.colour[2] = blue;
+    src.on = true;
+    src.dirty = true;
+    src.footprint.assign(Channels * (2 * radius + 1) * (2 * radius + 1), 0);
+    return id;
+}
+
+
+void
+LightMap::moveSource(SourceId id, Point at)
+{
+    assert(m_sources[id].on);
+    m_sources[id].at = at;
+    m_sources[id].dirty = true;
+}
+
+
+void
+LightMap::removeSource(SourceId id)
+{
+    assert(m_sources[id].on);
+    m_sources[id].on = false;
+    std::vector<Level>().swap(m_sources[id].footprint);
+    m_free.push_back(id);
+    m_resum = true;
+}
+
+
+void
+LightMap::update(Map const & mp)
+{
+    // a change of terrain only matters to the sources which reach it
+    if (mp.getId() != m_map || (mp.getTerrainVersion() > m_version &&
+                                !mp.getChangesSince(m_version, m_changes)))
+    {
+        for (std::vector<Source>::iterator it = m_sources.begin(); it != m_sources.end(); ++it)
+            it->dirty = true;
+    }
+    else if (mp.getTerrainVersion() > m_version)
+    {
+        for (std::vector<MapChange>::const_iterator ch = m_changes.begin(); ch != m_changes.end(); ++ch)
+            if (ch->kind == MapChange::Terrain)
+                for (std::vector<Source>::iterator it = m_sources.begin(); it != m_sources.end(); ++it)
+                    if (std::abs(ch->x - it->at.X()) <= it->radius &&
+                        std::abs(ch->y - it->at.Y()) <= it->radius)
+                        it->dirty = true;
+    }
+    m_map = mp.getId();
+    m_version = mp.getVersion();
+
+    for (std::vector<Source>::iterator it = m_sources.begin(); it != m_sources.end(); ++it)
+        if (it->on && it->dirty)
+        {
+            cast(mp, *it);
+            m_resum = true;
+        }
+
+    if (!m_resum)
+        return;
+    std::fill(m_sum.begin(), m_sum.end(), 0);
+    for (std::vector<Source>::const_iterator it = m_sources.begin(); it != m_sources.end(); ++it)
+        if (it->on)
+            addFootprint(*it);
+    m_resum = false;
+}
+
+
+Light
+LightMap::getLight(int x, int y) const
+{
+    assert(x >= 0 && y >= 0 && x < m_xsize && y < m_ysize);
+    Level const *square = &m_sum[Channels * (y * m_xsize + x)];
+    Light const light = { std::min(255, int(square[0])), std::min(255, int(square[1])),
+                          std::min(255, int(square[2])) };
+    return light;
+}
+
+
+void
+LightMap::cast(Map const & mp, Source & src)
+{
+    std::fill(src.footprint.begin(), src.footprint.end(), 0);
+    Footprint light(&src.footprint[0], src.at, src.radius, src.colour, mp.getSize());
+    ShadowCast(OpaquePlane(mp.getOpaquePlane()), light, src.at.X(), src.at.Y(), src.radius);
+    src.dirty = false;
+    ++m_casts;
+}
+
+
+void
+LightMap::addFootprint(Source const & src)
+{
+    int const side = 2 * src.radius + 1;
+    int const left = src.at.X() - src.radius;
+    int const top = src.at.Y() - src.radius;
+    int const x0 = std::max(0, left);
+    int const x1 = std::min(m_xsize, left + side);
+    if (x0 >= x1)
+        return;
+
+    for (int y = std::max(0, top); y < std::min(m_ysize, top + side); ++y)
+        AddRow(&m_sum[Channels * (y * m_xsize + x0)],
+               &src.footprint[Channels * ((y - top) * side + x0 - left)],
+               Channels * (x1 - x0));
+}
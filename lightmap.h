@@ -0,0 +1,139 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#ifndef H_LIGHTMAP_
+#define H_LIGHTMAP_ 1
+
+#include <vector>
+
+#include "boost/cstdint.hpp"
+#include "boost/noncopyable.hpp"
+
+#include "changejournal.h"
+#include "handles.h"
+
+class Map;
+
+
+/**
+ * Colour of the light falling on a square, each channel 0 (dark) to 255
+ */
+struct Light
+{
+    int red;
+    int green;
+    int blue;
+};
+
+
+/**
+ * LightMap adds up the light from many coloured sources - torches, lava,
+ * glowing monsters - over every square of a Map. Each source lights what
+ * ShadowCast says it can see within its radius, fading with the square of
+ * the distance.
+ *
+ * The squares each source lights are kept. update() reads the Map's change
+ * journal and shadowcasts again only the sources with changed terrain
+ * within their radius, or which have been moved. The kept light is then
+ * summed into one buffer, a row of each source at a time.
+ */
+class LightMap : private boost::noncopyable
+{
+public:
+    typedef int SourceId;
+
+    /**
+     * Create a dark map
+     *
+     * @param x      width of Map
+     * @param y      height of Map
+     */
+    LightMap(int x, int y);
+
+    /**
+     * Add a source of light. It is cast on the next update().
+     *
+     * @param at     square lit
+     * @param radius how far the light reaches
+     * @param red    brightness at the source, 0 to 255
+     * @param green
+     * @param blue
+     * @return       id of source, until it is removed
+     */
+    SourceId addSource(Point at, int radius, int red, int green, int blue);
+
+    /**
+     * Move a source, such as a monster carrying a torch
+     *
+     * @param id     source
+     * @param at     new square
+     */
+    void moveSource(SourceId id, Point at);
+
+    /**
+     * Put out a source
+     *
+     * @param id     source, whose id may then be reused
+     */
+    void removeSource(SourceId id);
+
+    /**
+     * Bring the light up to date with the Map
+     *
+     * @param mp     Map lit, the size given to the constructor
+     */
+    void update(Map const & mp);
+
+    /**
+     * Get the light on a square, as of the last update()
+     *
+     * @param x      x-coordinate
+     * @param y      y-coordinate
+     * @return       light, each channel at most 255
+     */
+    Light getLight(int x, int y) const;
+
+    /**
+     * Number of times a source has been shadowcast
+     *
+     * @return       casts
+     */
+    unsigned long getCasts() const { return m_casts; }
+
+private:
+    // red, green, blue and padding per square, so two squares fill 128 bits
+    enum
+    {
+        Channels = 4
+    };
+    typedef boost::uint16_t Level;
+
+    struct Source
+    {
+        Point at;
+        int radius;
+        int colour[3];
+        bool on;
+        bool dirty;
+        std::vector<Level> footprint;   // (2 * radius + 1) squared squares
+    };
+
+    void cast(Map const & mp, Source & src);
+    void addFootprint(Source const & src);
+
+    std::vector<Source> m_sources;
+    std::vector<SourceId> m_free;
+    std::vector<Level> m_sum;
+    bool m_resum;
+    MapId m_map;
+    unsigned long m_version;
+    std::vector<MapChange> m_changes;
+    unsigned long m_casts;
+    int m_xsize;
+    int m_ysize;
+};
+
+
+
+#endif
@@ -0,0 +1,122 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#include <algorithm>
+
+#include "bitplane.h"
+#include "losservice.h"
+#include "map.h"
+
+
+namespace
+{
+    bool InRange(Point a, Point b, int radius)
+    {
+        int const dx = a.X() - b.X();
+        int const dy = a.Y() - b.Y();
+        return dx * dx + dy * dy <= radius * radius;
+    }
+
+    // Map::VisitLineFromAtoB() visitor stopping at the first opaque square
+    // between the ends
+    struct Clear
+    {
+        Clear(Bitplane const & o, Point a, Point b) : opaque(o), first(a), last(b) {}
+
+        bool operator()(Point at) const
+        {
+            return at == first || at == last || !opaque.test(at.X(), at.Y());
+        }
+
+        Bitplane const & opaque;
+        Point first;
+        Point last;
+    };
+}
+
+
+//============================================================================
+// LOSService
+//============================================================================
+LOSService::LOSService() :
+    m_memo(MemoSlots),
+    m_generation(1),
+    m_map(0),
+    m_version(0),
+    m_traces(0)
+{
+    Memo const empty = { 0, 0, false };
+    std::fill(m_memo.begin(), m_memo.end(), empty);
+}
+
+
+bool
+LOSService::canSee(Map const & mp, Point a, Point b, int radius)
+{
+    if (!InRange(a, b, radius))
+        return false;
+    refresh(mp);
+    return lookup(mp.getOpaquePlane(), a, b);
+}
+
+
+void
+LOSService::canSeeMany(Map const & mp, std::vector<Point> const & from, Point to, int radius,
+                       std::vector<char> & out)
+{
+    // check the terrain version once for the lot, and trace only those
+    // in range
+    refresh(mp);
+    Bitplane const & opaque = mp.getOpaquePlane();
+    out.resize(from.size());
+    for (std::size_t i = 0; i < from.size(); ++i)
+        out[i] = InRange(from[i], to, radius) && lookup(opaque, from[i], to);
+}
+
+
+void
+LOSService::refresh(Map const & mp)
+{
+    if (mp.getId() == m_map && mp.getTerrainVersion() == m_version)
+        return;
+    m_map = mp.getId();
+    m_version = mp.getTerrainVersion();
+
+    // forget every answer at once. Generation 0 is never current
+    if (++m_generation == 0)
+    {
+        for (std::vector<Memo>::iterator it = m_memo.begin(); it != m_memo.end(); ++it)
+            it->generation = 0;
+        m_generation = 1;
+    }
+}
+
+
+bool
+LOSService::lookup(Bitplane const & opaque, Point a, Point b)
+{
+    // the same line whichever way round it is asked for
+    if (b < a)
+        std::swap(a, b);
+
+    boost::uint64_t const width = opaque.getWidth();
+    boost::uint64_t const key = ((a.Y() * width + a.X()) << 32) | (b.Y() * width + b.X());
+    Memo & memo = m_memo[((key >> 32) * 2654435761U ^ key) % MemoSlots];
+    if (memo.generation == m_generation && memo.key == key)
+        return memo.visible;
+
+    memo.key = key;
+    memo.generation = m_generation;
+    memo.visible = Trace(opaque, a, b);
+    ++m_traces;
+    return memo.visible;
+}
+
+
+bool
+LOSService::Trace(Bitplane const & opaque, Point a, Point b)
+{
+    Clear clear(opaque, a, b);
+    return Map::VisitLineFromAtoB(a, b, clear);
+}
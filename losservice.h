@@ -0,0 +1,91 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#ifndef H_LOSSERVICE_
+#define H_LOSSERVICE_ 1
+
+#include <vector>
+
+#include "boost/cstdint.hpp"
+#include "boost/noncopyable.hpp"
+
+#include "handles.h"
+
+class Bitplane;
+class Map;
+
+
+/**
+ * LOSService answers "can a creature at A see B?" for a Map. Sight runs
+ * along the Bresenham line of Map::TraceLineFromAtoB(), always traced from
+ * the lesser end (by row, then column), so A sees B exactly when B sees A.
+ * Only the squares strictly between the two need to be clear.
+ *
+ * Answers are kept in a fixed-size table, one per slot, until the Map's
+ * terrain version changes. Creatures coming and going leave them be, as
+ * creatures do not block sight.
+ */
+class LOSService : private boost::noncopyable
+{
+public:
+    enum
+    {
+        MemoSlots = 4096
+    };
+
+    LOSService();
+
+    /**
+     * Can a creature at one square see another?
+     *
+     * @param mp     map
+     * @param a      one square
+     * @param b      other square
+     * @param radius how far can be seen, in a straight line
+     * @return       true if b is no further than radius and in sight
+     */
+    bool canSee(Map const & mp, Point a, Point b, int radius);
+
+    /**
+     * canSee() for many viewers of one square, such as every monster near
+     * the hero. The answers are remembered just as canSee() remembers them.
+     *
+     * @param mp     map
+     * @param from   viewers
+     * @param to     square looked at
+     * @param radius how far each viewer can see
+     * @param out    resized to from, then set to 1 where from[i] sees to
+     */
+    void canSeeMany(Map const & mp, std::vector<Point> const & from, Point to, int radius,
+                    std::vector<char> & out);
+
+    /**
+     * Number of lines traced, rather than answered from the table
+     *
+     * @return       traces
+     */
+    unsigned long getTraces() const { return m_traces; }
+
+private:
+    struct Memo
+    {
+        boost::uint64_t key;
+        unsigned int    generation;
+        bool            visible;
+    };
+
+    void refresh(Map const & mp);
+    bool lookup(Bitplane const & opaque, Point a, Point b);
+    static bool Trace(Bitplane const & opaque, Point a, Point b);
+
+    std::vector<Memo> m_memo;
+    unsigned int m_generation;
+    MapId m_map;
+    unsigned long m_version;
+    unsigned long m_traces;
+};
+
+
+
+#endif
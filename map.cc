@@ -6,20 +6,20 @@
 #include <cassert>
 #include <cstdlib>
 #include <functional>
-#include <set>
-#include <stack>
+#include <limits>
 #include <utility>
 #include <vector>
 
-#include "boost/multi_index_container.hpp"
-#include "boost/multi_index/ordered_index.hpp"
-#include "boost/multi_index/identity.hpp"
-#include "boost/multi_index/member.hpp"
-
 #include "creature.h"
 #include "dice.h"
 #include "item.h"
+#include "lightmap.h"
+#include "losservice.h"
 #include "map.h"
+#include "pathfind.h"
+#include "pathhierarchy.h"
+#include "pathpool.h"
+#include "timeline.h"
 
 //============================================================================
 // Map::Terrain data
@@ -66,6 +66,40 @@ namespace
         {"desert", Representation('.', Colour::Yellow), Passable}
 
     };
+
+    // chasers further than this from the hero don't get a distance
+    int const ChaseRange = 128;
+
+    // width and height of the clusters routeFind() searches between
+    int const RouteCluster = 16;
+
+    // changes kept for Map::getChangesSince()
+    std::size_t const JournalSize = 4096;
+
+    // what getItemPile() gives for a square with nothing on it
+    ItemPileH const EmptyItemPile(new ItemPile(52));
+
+    // Maps are only made by the main thread
+    MapId NextMapId()
+    {
+        static MapId last = 0;
+        return ++last;
+    }
+
+    // the caller of pathFindMany() takes a share of the batch as well
+    PathPool & ThePathPool()
+    {
+        static PathPool pool(std::max(1U, boost::thread::hardware_concurrency()) - 1);
+        return pool;
+    }
+
+    // Map::VisitLineFromAtoB() visitor building TraceLineFromAtoB()
+    struct AppendSquare
+    {
+        explicit AppendSquare(std::vector<Point> & o) : out(o) {}
+        bool operator()(Point at) { out.push_back(at); return true; }
+        std::vector<Point> & out;
+    };
 }
 
 
@@ -74,24 +108,83 @@ namespace
 // Map
 //============================================================================
 Map::Map(int x, int y, Map::Terrain t) :
+    m_id(NextMapId()),
     m_actors(),
-    m_grid(y * x, t),
-    m_seengrid(y * x, Dark),
-    m_heroseen(y * x, 0),
-    m_creatures(),
-    m_itempiles(),
+    m_timeline(0),
+    m_dice(0, 32767, Dice::Random0(std::numeric_limits<int>::max())),
+    m_grid(x, y, t),
+    m_seengrid(x, y, 0U),
+    m_seen_generation(1),
+    m_heroseen(x, y, 0),
+    m_creatures(y * x),
+    m_creature_buckets(x, y),
+    m_itempiles(y * x),
+    m_piles_reclaimed(0),
+    m_passable(x, y, TerrainI[t].passable == Passable),
+    m_opaque(x, y, TerrainI[t].passable == Impassable),
+    m_occupied(x, y),
+    m_free(y * x),
+    m_pathfinder(),
+    m_pathmode(AStar),
+    m_route_distance(0),
+    m_chasefield(),
+    m_hierarchy(),
+    m_los(),
+    m_lights(),
+    m_chase_target(),
+    m_chase_dirty(true),
+    m_lookers(),
+    m_sighted(),
+    m_sighted_hero(),
+    m_sighted_radius(-1),
+    m_sighted_version(0),
+    m_stamps(x, y, 0U),
+    m_stamp(0),
+    m_journal(JournalSize),
+    m_terrain_version(0),
     m_xsize(x),
     m_ysize(y)
 {
+    if (TerrainI[t].passable == Passable)
+        for (int i = 0; i < x * y; ++i)
+            m_free.insert(i);
 }
 
 Map::Map(int x, int y, char const *tmplt, Map::TerrainMapping const & tmk) :
+    m_id(NextMapId()),
     m_actors(),
-    m_grid(y * x),
-    m_seengrid(y * x, Dark),
-    m_heroseen(y * x, 0),
-    m_creatures(),
-    m_itempiles(),
+    m_timeline(0),
+    m_dice(0, 32767, Dice::Random0(std::numeric_limits<int>::max())),
+    m_grid(x, y, DirtFloor),
+    m_seengrid(x, y, 0U),
+    m_seen_generation(1),
+    m_heroseen(x, y, 0),
+    m_creatures(y * x),
+    m_creature_buckets(x, y),
+    m_itempiles(y * x),
+    m_piles_reclaimed(0),
+    m_passable(x, y),
+    m_opaque(x, y),
+    m_occupied(x, y),
+    m_free(y * x),
+    m_pathfinder(),
+    m_pathmode(AStar),
+    m_route_distance(0),
+    m_chasefield(),
+    m_hierarchy(),
+    m_los(),
+    m_lights(),
+    m_chase_target(),
+    m_chase_dirty(true),
+    m_lookers(),
+    m_sighted(),
+    m_sighted_hero(),
+    m_sighted_radius(-1),
+    m_sighted_version(0),
+    m_stamps(x, y, 0U),
+    m_stamp(0),
+    m_journal(JournalSize),
+    m_terrain_version(0),
     m_xsize(x),
     m_ysize(y)
 {
@@ -106,12 +199,134 @@ Map::Map(int x, int y, char const *tmplt, Map::TerrainMapping const & tmk) :
         setTerrain(i % x, i / x, terrain[tmplt[i] - 32]);
 }
 
+Map::Map(int x, int y, boost::shared_ptr<TerrainSource const> src) :
+    m_id(NextMapId()),
+    m_actors(),
+    m_timeline(0),
+    m_dice(0, 32767, Dice::Random0(std::numeric_limits<int>::max())),
+    m_grid(x, y, DirtFloor),
+    m_seengrid(x, y, 0U),
+    m_seen_generation(1),
+    m_heroseen(x, y, 0),
+    m_creatures(y * x),
+    m_creature_buckets(x, y),
+    m_itempiles(y * x),
+    m_piles_reclaimed(0),
+    m_passable(x, y),
+    m_opaque(x, y),
+    m_occupied(x, y),
+    m_free(y * x),
+    m_pathfinder(),
+    m_pathmode(AStar),
+    m_route_distance(0),
+    m_chasefield(),
+    m_hierarchy(),
+    m_los(),
+    m_lights(),
+    m_chase_target(),
+    m_chase_dirty(true),
+    m_lookers(),
+    m_sighted(),
+    m_sighted_hero(),
+    m_sighted_radius(-1),
+    m_sighted_version(0),
+    m_stamps(x, y, 0U),
+    m_stamp(0),
+    m_journal(JournalSize),
+    m_terrain_version(0),
+    m_xsize(x),
+    m_ysize(y)
+{
+    m_grid.setSource(src);
+
+    // the bitplanes need every square, so walk a chunk at a time and drop
+    // each once read. Nothing has been changed, so that costs nothing
+    int const side = Grid::ChunkSide;
+    for (int cy = 0; cy < y; cy += side)
+        for (int cx = 0; cx < x; cx += side)
+        {
+            for (int j = cy; j < std::min(y, cy + side); ++j)
+                for (int i = cx; i < std::min(x, cx + side); ++i)
+                {
+                    bool const passable = TerrainI[m_grid.get(i, j)].passable == Passable;
+                    m_passable.set(i, j, passable);
+                    m_opaque.set(i, j, !passable);
+                    m_free.set(j * x + i, passable);
+                }
+            m_grid.evict(0);
+        }
+}
+
+
+Map::~Map()
+{
+}
+
 
 ActorH
 Map::getNextActor() const
 {
     assert(!m_actors.empty() && "No Actor to fetch - getNextActor()");
-    return m_actors.front();
+    return m_actors.top();
+}
+
+
+void
+Map::skipToTurn(unsigned int turn)
+{
+    std::vector<CreatureH> creatures;
+    getCreatures(creatures);
+    for (std::vector<CreatureH>::iterator it = creatures.begin(); it != creatures.end(); ++it)
+    {
+        unsigned int const now = (*it)->getTurn();
+        if (now >= turn)
+            continue;
+        unsigned int const speed = (*it)->getSpeed();
+        updateActor(*it, (turn - now + speed - 1) / speed * speed);
+    }
+}
+
+
+unsigned int
+Map::getNextTurn() const
+{
+    return m_actors.empty() ? std::numeric_limits<unsigned int>::max() : m_actors.top()->getTurn();
+}
+
+
+void
+Map::setTimeline(Timeline *tl)
+{
+    m_timeline = tl;
+}
+
+
+MapId
+Map::getId() const
+{
+    return m_id;
+}
+
+
+bool
+Map::hasHero() const
+{
+    return m_chase_target.X() >= 0;
+}
+
+
+Dice &
+Map::getDice()
+{
+    return m_dice;
+}
+
+
+void
+Map::headChanged() const
+{
+    if (m_timeline)
+        m_timeline->update(this);
 }
 
 
@@ -119,26 +334,25 @@ void
 Map::updateActor(ActorH act, unsigned int nt)
 {
     assert(act->getCoords().M().get() == this && "updateActor() called for non-matching Map");
-    // linear find() is ok, because Actor will usually be at the front
-    Actors::iterator it = std::find(m_actors.begin(), m_actors.end(), act);
-    if (it != m_actors.end())
-        m_actors.erase(it);
     act->m_turn += nt;
-    m_actors.push_back(act);
-    m_actors.sort(Actor::ActorComp());
+    if (m_actors.contains(act))
+        m_actors.reschedule(act);
+    else
+        m_actors.push(act);
+    headChanged();
 }
 
 
 Map::Terrain
-Map::getTerrain(Coords c) const
+Map::getTerrain(Point c) const
 {
     assert(c.X() >= 0 && c.Y() >= 0 && c.X() < m_xsize && c.Y() < m_ysize);
-    return m_grid[c.y * m_xsize + c.x];
+    return m_grid.get(c.x, c.y);
 }
 
 
 std::string const &
-Map::getTerrainName(Coords c) const
+Map::getTerrainName(Point c) const
 {
     return TerrainI[getTerrain(c)].name;
 }
@@ -146,7 +360,7 @@ Map::getTerrainName(Coords c) const
 
 
 void
-Map::setTerrain(Coords c, Map::Terrain t)
+Map::setTerrain(Point c, Map::Terrain t)
 {
     assert(insideBoundaries(c));
     setTerrain(c.x, c.y, t);
@@ -156,28 +370,103 @@ Map::setTerrain(Coords c, Map::Terrain t)
 void
 Map::setTerrain(int x,  int y,  Map::Terrain t)
 {
-    m_grid.at(y * m_xsize + x) = t;
+    m_grid.set(x, y, t);
+    bool const passable = TerrainI[t].passable == Passable;
+    m_passable.set(x, y, passable);
+    m_opaque.set(x, y, !passable);
+    m_free.set(y * m_xsize + x, passable && !m_occupied.test(x, y));
+    m_chase_dirty = true;
+    if (m_hierarchy)
+        m_hierarchy->setPassable(x, y, passable);
+    touchSquare(x, y);
+    m_terrain_version = m_journal.record(x, y, MapChange::Terrain);
+}
+
+
+void
+Map::touchSquare(int x, int y)
+{
+    m_stamps.set(x, y, ++m_stamp);
+}
+
+
+unsigned int
+Map::getSquareStamp(Point c) const
+{
+    assert(insideBoundaries(c));
+    return m_stamps.get(c.x, c.y);
+}
+
+
+unsigned long
+Map::getVersion() const
+{
+    return m_journal.getVersion();
+}
+
+
+bool
+Map::getChangesSince(unsigned long version, std::vector<MapChange> & out) const
+{
+    return m_journal.getChangesSince(version, out);
+}
+
+
+std::size_t
+Map::evictChunks(std::size_t keep)
+{
+    return m_grid.evict(keep) + m_heroseen.evict(keep) + m_stamps.evict(keep);
+}
+
+
+long
+Map::getChunkCacheBytes() const
+{
+    return m_grid.getCacheBytes() + m_heroseen.getCacheBytes() + m_stamps.getCacheBytes();
+}
+
+
+long
+Map::getResidentChunkBytes() const
+{
+    return m_grid.getResidentBytes() + m_seengrid.getResidentBytes() +
+           m_heroseen.getResidentBytes() + m_stamps.getResidentBytes();
+}
+
+
+LightMap &
+Map::getLightMap()
+{
+    if (!m_lights)
+        m_lights.reset(new LightMap(m_xsize, m_ysize));
+    return *m_lights;
 }
 
 
 Representation
 Map::getTerrainRep(int x, int y) const
 {
-    return TerrainI[m_grid[y * m_xsize + x]].representation;
+    return TerrainI[m_grid.get(x, y)].representation;
 }
 
 
 CreatureH
-Map::getCreature(Coords c) const
+Map::getCreature(Point c) const
 {
     assert(insideBoundaries(c));
-    Creatures::const_iterator i = m_creatures.find(xyToHash(c));
-    return i == m_creatures.end() ? CreatureH() : i->second;
+    return m_creatures.get(c.y * m_xsize + c.x);
+}
+
+
+void
+Map::getCreatures(std::vector<CreatureH> & out) const
+{
+    m_creatures.collect(out);
 }
 
 
 void
-Map::addCreature(Coords c, CreatureH creature)
+Map::addCreature(Point c, CreatureH creature)
 {
     assert(insideBoundaries(c));
     Map *oldmap = creature->getCoords().M().get();
@@ -190,88 +479,176 @@ Map::addCreature(Coords c, CreatureH creature)
 void
 Map::addCreature(int x, int y, CreatureH creature)
 {
-    m_creatures.insert(Creatures::value_type(xyToHash(x, y), creature));
-    m_actors.push_back(creature);
-    m_actors.sort(Actor::ActorComp());
-    creature->m_coords = Coords(x,  y);
-    creature->m_coords.setMap(shared_from_this());
+    m_creatures.insert(y * m_xsize + x, creature);
+    m_creature_buckets.insert(Point(x, y));
+    m_occupied.set(x, y, true);
+    m_free.remove(y * m_xsize + x);
+    touchSquare(x, y);
+    m_journal.record(x, y, MapChange::CreatureEnter);
+    if (m_actors.contains(creature))
+        m_actors.reschedule(creature);
+    else
+        m_actors.push(creature);
+    headChanged();
+    creature->m_coords = Coords(Point(x, y), shared_from_this());
+    if (creature->heroGUID())
+    {
+        m_chase_target = Point(x, y);
+        m_chase_dirty = true;
+    }
 }
 
 
-void
+bool
 Map::addCreature(Position /*pos*/, CreatureH creature)
 {
     // TODO: map-default positions
-    for (bool ok = false; !ok; )
-    {
-        Coords coord(Dice::Random0(m_xsize), Dice::Random0(m_ysize));
-        if (isPassable(coord, creature))
-        {
-            addCreature(coord, creature);
-            ok = true;
-        }
-    }
+    Point coord;
+    if (!getRandomFreeSquare(coord))
+        return false;
+    addCreature(coord, creature);
+    return true;
+}
+
+
+bool
+Map::getRandomFreeSquare(Point & out) const
+{
+    if (m_free.empty())
+        return false;
+    int const index = m_free.get(Dice::Random0(static_cast<int>(m_free.size())));
+    out = Point(index % m_xsize, index / m_xsize);
+    return true;
 }
 
 
 CreatureH
-Map::delCreature(Coords c)
+Map::delCreature(Point c)
 {
-    assert(c.M().get() == this && "delCreature() called for non-matching Map");
     assert(insideBoundaries(c));
-    Creatures::iterator it = m_creatures.find(xyToHash(c));
-    assert(it != m_creatures.end());
-    CreatureH critter(it->second);
-    m_creatures.erase(it);
-    m_actors.remove(critter);
+    CreatureH critter(m_creatures.take(c.y * m_xsize + c.x));
+    assert(critter);
+    m_creature_buckets.remove(c);
+    m_occupied.set(c.x, c.y, false);
+    m_free.set(c.y * m_xsize + c.x, m_passable.test(c.x, c.y));
+    touchSquare(c.x, c.y);
+    m_journal.record(c.x, c.y, MapChange::CreatureLeave);
+    if (m_actors.contains(critter))
+    {
+        m_actors.remove(critter);
+        headChanged();
+    }
+    if (critter->heroGUID())
+        m_chase_target = Point();
     return critter;
 }
 
 
 void
-Map::moveCreature(Coords c, CreatureH cr)
+Map::moveCreature(Point c, CreatureH cr)
 {
-    assert(c.M().get() == this && "moveCreature() called for non-matching Map");
+    assert(cr->getCoords().M().get() == this && "moveCreature() called for non-matching Map");
     assert(insideBoundaries(c));
-    Coords coords(cr->getCoords());
-    m_creatures.erase(xyToHash(coords));
-    m_creatures.insert(Creatures::value_type(xyToHash(c), cr));
+    Point coords(cr->getCoords());
+    // put down before taking up, so a lone creature moving about its page
+    // of the occupancy layer doesn't free it and allocate it again
+    if (c != coords)
+    {
+        m_creatures.insert(c.y * m_xsize + c.x, cr);
+        m_creatures.take(coords.y * m_xsize + coords.x);
+    }
+    m_creature_buckets.move(coords, c);
+    m_occupied.set(coords.x, coords.y, false);
+    m_occupied.set(c.x, c.y, true);
+    m_free.set(coords.y * m_xsize + coords.x, m_passable.test(coords.x, coords.y));
+    m_free.remove(c.y * m_xsize + c.x);
+    touchSquare(coords.x, coords.y);
+    touchSquare(c.x, c.y);
+    m_journal.record(coords.x, coords.y, MapChange::CreatureLeave);
+    m_journal.record(c.x, c.y, MapChange::CreatureEnter);
     cr->m_coords.x = c.x;
     cr->m_coords.y = c.y;
+    if (cr->heroGUID())
+    {
+        m_chase_target = Point(c.x, c.y);
+        m_chase_dirty = true;
+    }
 }
 
 
 bool
-Map::insideBoundaries(Coords c) const
+Map::insideBoundaries(Point c) const
 {
     return c.X() >= 0 && c.Y() >= 0 && c.X() < m_xsize && c.Y() < m_ysize;
 }
 
-Coords
+Point
 Map::getSize() const
 {
-    return Coords(m_xsize, m_ysize);
+    return Point(m_xsize, m_ysize);
 }
 
 
 
 
 ItemPileH
-Map::getItemPile(Coords c) const
+Map::getItemPile(Point c) const
+{
+    assert(insideBoundaries(c));
+    int const index = c.y * m_xsize + c.x;
+    return m_itempiles.occupied(index) ? m_itempiles.get(index) : EmptyItemPile;
+}
+
+
+ItemPileH
+Map::openItemPile(Point c)
+{
+    assert(insideBoundaries(c));
+    int const index = c.y * m_xsize + c.x;
+    if (!m_itempiles.occupied(index))
+        m_itempiles.insert(index, ItemPileH(new ItemPile(52)));
+    m_journal.record(c.x, c.y, MapChange::ItemPile);
+    return m_itempiles.get(index);
+}
+
+
+bool
+Map::reclaimItemPile(Point c)
 {
     assert(insideBoundaries(c));
-    unsigned long hash = xyToHash(c);
-    ItemPiles::const_iterator i = m_itempiles.find(hash);
-    if (i != m_itempiles.end())
-        return i->second;
-    ItemPileH tmp(new ItemPile(52));
-    return m_itempiles.insert(ItemPiles::value_type(hash, tmp)).first->second;
+    int const index = c.y * m_xsize + c.x;
+    if (!m_itempiles.occupied(index) || !m_itempiles.get(index)->empty())
+        return false;
+    m_itempiles.take(index);
+    ++m_piles_reclaimed;
+    return true;
+}
+
+
+std::size_t
+Map::getItemPileCount() const
+{
+    return m_itempiles.size();
+}
+
+
+std::size_t
+Map::getItemPileSlots() const
+{
+    return m_itempiles.capacity();
+}
+
+
+unsigned long
+Map::getItemPilesReclaimed() const
+{
+    return m_piles_reclaimed;
 }
 
 
 
 ItemPileH
-Map::addItem(Coords c, ItemH item)
+Map::addItem(Point c, ItemH item)
 {
     assert(insideBoundaries(c));
     return addItem(c.x, c.y, item);
@@ -281,77 +658,72 @@ Map::addItem(Coords c, ItemH item)
 ItemPileH
 Map::addItem(int x, int y, ItemH item)
 {
-    unsigned long hash = xyToHash(x, y);
-    ItemPiles::iterator it = m_itempiles.find(hash);
-    if (it == m_itempiles.end())
-    {
-        ItemPileH tmp(new ItemPile(52));
-        tmp->addItemToPile(item);
-        return m_itempiles.insert(
-            ItemPiles::value_type(hash, tmp)).first->second;
-    }
-    it->second->addItemToPile(item);
-    return it->second;
+    int const index = y * m_xsize + x;
+    if (!m_itempiles.occupied(index))
+        m_itempiles.insert(index, ItemPileH(new ItemPile(52)));
+    ItemPileH const & pile = m_itempiles.get(index);
+    pile->addItemToPile(item);
+    m_journal.record(x, y, MapChange::ItemPile);
+    return pile;
 }
 
 
 ItemPileH
-Map::addItemPile(Coords c, ItemPileH itemp)
+Map::addItemPile(Point c, ItemPileH itemp)
 {
     assert(insideBoundaries(c));
-    unsigned long hash = xyToHash(c);
-    ItemPiles::iterator it = m_itempiles.find(hash);
-    if (it == m_itempiles.end())
-        return m_itempiles.insert(ItemPiles::value_type(hash, itemp)).first->second;
-    TransferAllItems(itemp, it->second);
-    return it->second;
+    int const index = c.y * m_xsize + c.x;
+    m_journal.record(c.x, c.y, MapChange::ItemPile);
+    if (m_itempiles.insert(index, itemp))
+        return itemp;
+    ItemPileH const & pile = m_itempiles.get(index);
+    TransferAllItems(itemp, pile);
+    return pile;
 }
 
 
 
 ItemPileH
-Map::delItem(Coords c, ItemH item)
+Map::delItem(Point c, ItemH item)
 {
     assert(insideBoundaries(c));
-    unsigned long hash = xyToHash(c);
-    ItemPiles::iterator it = m_itempiles.find(hash);
-    if (it != m_itempiles.end())
-        it->second->delItem(item);
-    return it->second;
+    int const index = c.y * m_xsize + c.x;
+    if (!m_itempiles.occupied(index))
+        return EmptyItemPile;
+    ItemPileH pile(m_itempiles.get(index));
+    pile->delItem(item);
+    m_journal.record(c.x, c.y, MapChange::ItemPile);
+    return reclaimItemPile(c) ? EmptyItemPile : pile;
 }
 
 
 ItemPileH
-Map::delItemPile(Coords c)
+Map::delItemPile(Point c)
 {
     assert(insideBoundaries(c));
-    unsigned long hash = xyToHash(c);
-    ItemPileH tmp = m_itempiles[hash];
-    m_itempiles.erase(hash);
-    return tmp;
+    m_journal.record(c.x, c.y, MapChange::ItemPile);
+    return m_itempiles.take(c.y * m_xsize + c.x);
 }
 
 
 
 bool
-Map::isPassable(Coords c, CreatureH /*cr*/) const
+Map::isPassable(Point c, CreatureH /*cr*/) const
 {
-    if (c.X() < 0 || c.X() >= m_xsize || c.Y() < 0 || c.Y() >= m_ysize)
-        return false;
-    return TerrainI[getTerrain(c)].passable == Passable;
+    return m_passable.test(c.x, c.y);
 }
 
 
 bool
-Map::blocksVision(Coords c, CreatureH /*cr*/) const
+Map::blocksVision(Point c, CreatureH /*cr*/) const
 {
     assert(insideBoundaries(c));
-    return !TerrainI[getTerrain(c)].passable;
+    return m_opaque.test(c.x, c.y);
 }
 
 
 Representation
-Map::getRepresentation(Coords c, CreatureH cr)
+Map::getRepresentation(Point c, CreatureH cr)
 {
     assert(insideBoundaries(c));
     Representation rep(' ', Colour::White);
@@ -372,14 +744,19 @@ Map::getRepresentation(Coords c, CreatureH cr)
 void
 Map::clearSeenGrid()
 {
-    SeenGrid(m_xsize * m_ysize, Dark).swap(m_seengrid);
+    // squares lit in the generation wrapped back round to would show up
+    if (++m_seen_generation == 0)
+    {
+        m_seengrid.clear();
+        m_seen_generation = 1;
+    }
 }
 
 
 void
 Map::setSeenGrid(int x, int y, Map::Lighting l)
 {
-    m_seengrid[y * m_xsize + x] = l;
+    m_seengrid.set(x, y, l == Lit ? m_seen_generation : 0U);
 }
 
 
@@ -387,7 +764,7 @@ Map::setSeenGrid(int x, int y, Map::Lighting l)
 Map::Lighting
 Map::getSeenGrid(int x, int y)
 {
-    return m_seengrid[y * m_xsize + x];
+    return m_seengrid.get(x, y) == m_seen_generation ? Lit : Dark;
 }
 
 
@@ -395,14 +772,14 @@ Map::getSeenGrid(int x, int y)
 void
 Map::setHeroSeenChar(int x, int y)
 {
-    m_heroseen[y * m_xsize + x] = getTerrainRep(x, y).first;
+    m_heroseen.set(x, y, getTerrainRep(x, y).first);
 }
 
 
 char
 Map::getHeroSeenChar(int x, int y) const
 {
-    return m_heroseen[y * m_xsize + x];
+    return m_heroseen.get(x, y);
 }
 
 
@@ -413,187 +790,341 @@ Map::getHeroSeenMap()
 }
 
 
-unsigned long
-Map::xyToHash(Coords c) const
+int
+Map::ManhattanDistance(Point a, Point b)
 {
-    return (static_cast<unsigned long>(c.x) << 16) | c.y;
+    return std::max(std::abs(a.x - b.x), std::abs(a.y- b.y));
 }
 
 
-unsigned long
-Map::xyToHash(int x,  int y) const
+int 
+Map::RoguelikeDistance(Point a, Point b)
+{
+    return std::min(std::abs(a.x - b.x), std::abs(a.y - b.y));
+}
+
+
+std::vector<Point>
+Map::TraceLineFromAtoB(Point a, Point b)
 {
-    return (static_cast<unsigned long>(x) << 16) | y;
+    std::vector<Point> out;
+    AppendSquare append(out);
+    VisitLineFromAtoB(a, b, append);
+    return out;
 }
 
 
-Coords
-Map::hashToXY(unsigned long hash) const
+struct Map::StopAtOpaque
+{
+    StopAtOpaque(Bitplane const & o, Point a) : opaque(o), start(a), stop(a) {}
+
+    bool operator()(Point at)
+    {
+        // off the map is as opaque as a wall, but stops short of it
+        if (at.x < 0 || at.y < 0 || at.x >= opaque.getWidth() || at.y >= opaque.getHeight())
+            return false;
+        stop = at;
+        return at == start || !opaque.test(at.x, at.y);
+    }
+
+    Bitplane const & opaque;
+    Point start;
+    Point stop;
+};
+
+
+Point
+Map::traceToOpaque(Point a, Point b) const
 {
-    return Coords(hash >> 16, hash & 0xFFFF);
+    StopAtOpaque trace(m_opaque, a);
+    VisitLineFromAtoB(a, b, trace);
+    return trace.stop;
 }
 
 
-int
-Map::ManhattanDistance(Coords a, Coords b)
+bool
+Map::canSee(Point a, Point b, int radius) const
 {
-    return std::max(std::abs(a.x - b.x), std::abs(a.y- b.y));
+    if (!m_los)
+        m_los.reset(new LOSService);
+    return m_los->canSee(*this, a, b, radius);
 }
 
 
-int 
-Map::RoguelikeDistance(Coords a, Coords b)
+void
+Map::canSeeMany(std::vector<Point> const & from, Point to, int radius, std::vector<char> & out) const
 {
-    return std::min(std::abs(a.x - b.x), std::abs(a.y - b.y));
+    if (!m_los)
+        m_los.reset(new LOSService);
+    m_los->canSeeMany(*this, from, to, radius, out);
 }
 
 
-//! Bresenham line algorithm
-//  from http://en.wikipedia.org/wiki/Bresenham's_line_algorithm
-std::vector<Coords>
-Map::TraceLineFromAtoB(Coords a, Coords b)
+struct Map::GatherLookers
 {
-    std::vector<Coords> out;
+    GatherLookers(std::vector<Point> & l, Point h) : lookers(l), hero(h) {}
 
-    bool steep = std::abs(b.y - a.y) > std::abs(b.x - a.x);
-    if (steep == true)
+    bool operator()(CreatureH const &, Point at)
     {
-        std::swap(a.x,  a.y);
-        std::swap(b.x,  b.y);
+        if (at != hero)
+            lookers.push_back(at);
+        return true;
     }
-    int const deltax = std::abs(b.x - a.x);
-    int const deltay = std::abs(b.y - a.y);
-    int error = 0;
-    int deltaerr = deltay;
-    Coords curpos(a.x, a.y);
-    int xstep = (a.x < b.x) ? 1 : -1;
-    int ystep = (a.y < b.y) ? 1 : -1;
 
-    out.push_back((steep) ? Coords(curpos.y,  curpos.x) : curpos);
+    std::vector<Point> & lookers;
+    Point hero;
+};
 
-    while (curpos.x != b.x)
+
+void
+Map::lookForHero(Point hero, int radius)
+{
+    // sorted, so canSeeHero() can find a creature's square by halving
+    m_lookers.clear();
+    GatherLookers gather(m_lookers, hero);
+    visitCreaturesInRadius(hero, radius, gather);
+    std::sort(m_lookers.begin(), m_lookers.end());
+    canSeeMany(m_lookers, hero, radius, m_sighted);
+
+    m_sighted_hero = hero;
+    m_sighted_radius = radius;
+    m_sighted_version = m_terrain_version;
+}
+
+
+bool
+Map::canSeeHero(Point c, Point hero, int radius) const
+{
+    int const dx = c.x - hero.x;
+    int const dy = c.y - hero.y;
+    if (dx * dx + dy * dy > radius * radius)
+        return false;
+    if (hero == m_sighted_hero && radius <= m_sighted_radius && m_terrain_version == m_sighted_version)
     {
-        curpos.x += xstep;
-        error += deltaerr;
-        if (error * 2 >= deltax)
-        {
-            curpos.y += ystep;
-            error -= deltax;
-        }
-        out.push_back((steep) ? Coords(curpos.y,  curpos.x) : curpos);
+        std::vector<Point>::const_iterator it = std::lower_bound(m_lookers.begin(), m_lookers.end(), c);
+        if (it != m_lookers.end() && *it == c)
+            return m_sighted[it - m_lookers.begin()];
     }
-    return out;
+    return canSee(c, hero, radius);
 }
 
-//namespace
-//{
-    Coords Offsets[8] = { Coords(-1, -1), Coords(0, -1), Coords(1, -1),
-                          Coords(-1, 0),                 Coords(1, 0),
-                          Coords(-1, 1),  Coords(0, 1),  Coords(1, 1) }; 
 
-    struct Node;
-    typedef std::set<Node>         ClosedList;
-    typedef ClosedList::iterator   ClosedIter;
-    struct Node
-    {
-        Coords      coord;      // position
-        ClosedIter  parent;     // parent of this position
-        int         cost;       // cost to get here
-        int         total_cost; // cost to get here plus estimated cost to target
-                                // 
-        Node(Coords here, ClosedIter p, int cost_here, int total) :
-            coord(here), parent(p), cost(cost_here), total_cost(total) {}
-        bool operator< (Node const & rh) const
-        { return coord < rh.coord; }
-    };
+//============================================================================
+// Pathfinding
+//============================================================================
+struct Map::StepOpen
+{
+    explicit StepOpen(Map const & mp) : map(mp) {}
+    bool operator()(int x, int y) const { return map.isOpenSquare(x, y); }
+    Map const & map;
+};
 
-    using namespace boost::multi_index;
-    typedef multi_index_container<
-                                  Node, 
-                                  indexed_by<
-                                             ordered_unique<identity<Node> >, 
-                                             ordered_non_unique<member<Node, int, &Node::total_cost> >
-                                            >
-                                 > OpenList;
-
-    
-    void AddOrUpdateOpenList(OpenList & open_list, Node & node)
-    {
-        // strictly the get<0>() isn't required as multi_index is derived from index<0>
-        OpenList::iterator it = open_list.get<0>().find(node);
-        if (it != open_list.get<0>().end())
-        {
-            if (it->cost > node.cost)
-            {
-                open_list.get<0>().replace(it, node);
-            }
-            return;
-        }
-        open_list.insert(node);
 
-    }
+struct Map::StepOpenFor
+{
+    StepOpenFor(Map const & mp, Creature const *cr) : map(mp), me(cr) {}
+    bool operator()(int x, int y) const { return map.isOpenSquareFor(x, y, me); }
+    Map const & map;
+    Creature const *me;
+};
+
+
+struct Map::StepPassable
+{
+    explicit StepPassable(Map const & mp) : map(mp) {}
+    bool operator()(int x, int y) const { return map.isPassableSquare(x, y); }
+    Map const & map;
+};
+
+
+bool
+Map::isOpenSquare(int x, int y) const
+{
+    return m_passable.test(x, y) && !m_occupied.test(x, y);
+}
+
+
+bool
+Map::isOpenSquareFor(int x, int y, Creature const *cr) const
+{
+    if (!isPassableSquare(x, y))
+        return false;
+    CreatureH const & occupant = m_creatures.get(y * m_xsize + x);
+    return !occupant || occupant.get() == cr;
+}
 
 
-    std::vector<Coords> const & CalculatePath(Coords final, ClosedIter parent, ClosedIter end, std::vector<Coords> & path)
+bool
+Map::isPassableSquare(int x, int y) const
+{
+    return m_passable.test(x, y);
+}
+
+
+std::vector<Point> 
+Map::pathFind(Point s, Point e, CreatureH cr) const
+{
+    std::vector<Point> path;
+    pathFind(s, e, cr, path);
+    return path;
+}
+
+
+bool
+Map::pathFind(Point s, Point e, CreatureH /*cr*/, std::vector<Point> & path) const
+{
+    if (isLongRoute(s, e))
+        return routePath(s, e, path);
+    if (!m_pathfinder)
+        m_pathfinder.reset(new PathFinder(m_xsize, m_ysize));
+    return m_pathmode == JumpPoint ?
+           m_pathfinder->findJumpPath(StepOpen(*this), s, e, path) :
+           m_pathfinder->findPath(StepOpen(*this), s, e, path);
+}
+
+
+void
+Map::setPathMode(PathMode mode)
+{
+    m_pathmode = mode;
+}
+
+
+void
+Map::setRouteDistance(int distance)
+{
+    m_route_distance = distance;
+}
+
+
+bool
+Map::isLongRoute(Point s, Point e) const
+{
+    return m_route_distance > 0 && PathFinder::Heuristic(s.x, s.y, e.x, e.y) > m_route_distance;
+}
+
+
+bool
+Map::routePath(Point s, Point e, std::vector<Point> & path) const
+{
+    path.clear();
+    HierarchicalPath route;
+    if (!routeFind(s, e, route))
+        return false;
+    Point step;
+    for (Point from = s; m_hierarchy->nextStep(route, from, step); from = step)
+        path.push_back(step);
+    if (path.empty() || !(path.back() == e))
     {
-        std::stack<Coords> c_list;
-        c_list.push(final);
-        for ( ; parent != end && parent->parent != end; parent = parent->parent)
-        {
-            c_list.push(parent->coord);
-        }
-        while (!c_list.empty())
-        {
-            path.push_back(c_list.top());
-            c_list.pop();
-        }
-        return path;
+        path.clear();
+        return false;
     }
-//}
+    return true;
+}
 
 
-// Good description of A-Star from http://www.policyalmanac.org/games/aStarTutorial.htm
-std::vector<Coords> 
-Map::pathFind(Coords s, Coords e, CreatureH cr) const
+void
+Map::pathFindMany(std::vector<PathQuery> & queries) const
 {
-    std::vector<Coords> path;
-    if (s == e) return path;
+    // solve() returns only once every query is done, so nothing can change
+    // the planes under the workers
+    ThePathPool().solve(m_passable, m_occupied, m_pathmode == JumpPoint, queries);
+}
 
-    OpenList open_list;
-    ClosedList closed_list;
-    
-    open_list.insert(Node(s, closed_list.end(), 0, ManhattanDistance(s, e)));
 
-    while (!open_list.empty())
+bool
+Map::chaseStep(Point c, Point & step) const
+{
+    if (m_chase_target.X() < 0)
+        return false;
+
+    // creatures are left out of the field, as they move far more often than
+    // the hero does. They're only avoided when choosing the step itself
+    if (!m_chasefield)
+        m_chasefield.reset(new DistanceField(m_xsize, m_ysize));
+    if (m_chase_dirty)
     {
-        // Get the lowest total cost square on open list and put it on the closed list
-        ClosedIter parent = closed_list.insert(*open_list.get<1>().begin()).first;
-        open_list.erase(*open_list.get<1>().begin());
+        m_chasefield->compute(StepPassable(*this), m_chase_target, ChaseRange);
+        m_chase_dirty = false;
+    }
 
-        // for each of the 8 squares adjacent
-        for (int sq = 0; sq < 8; ++sq)
-        {
-            Coords square =  parent->coord + Offsets[sq];
+    if (m_chasefield->getDistance(c.X(), c.Y()) < 0)
+        return false;
+    if (!m_chasefield->stepDownhill(StepOpen(*this), c, step))
+        step = c;
+    return true;
+}
 
-            // is this the target?
-            if (square.X() == e.X() && square.Y() == e.Y())
-                return CalculatePath(square, parent, closed_list.end(), path);
 
-            // if it is not walkable, ignore it
-            if (!isPassable(square, cr) || getCreature(square)) continue;
+bool
+Map::routeFind(Point s, Point e, HierarchicalPath & route) const
+{
+    if (!m_hierarchy)
+        m_hierarchy.reset(new PathHierarchy(RouteCluster, m_passable));
+    return m_hierarchy->findRoute(s, e, route);
+}
 
-            // record the cost to get here and estimated cost to get to target
-            Node node(square, parent, parent->cost + 1, parent->cost + 1 + ManhattanDistance(square, e));
 
-            // if it is already on the closed list, ignore it.
-            if (closed_list.count(node)) continue;
+bool
+Map::routeStep(HierarchicalPath & route, Point c, Point & step) const
+{
+    if (!m_hierarchy || !m_hierarchy->nextStep(route, c, step))
+        return false;
+
+    // the leg may have been walled up or walked into since it was refined
+    if (isOpenSquare(step.x, step.y))
+        return true;
+    return m_hierarchy->detour(route, c, step);
+}
 
-            // add the node to the open list. update the node's parent if the cost is lower
-            AddOrUpdateOpenList(open_list, node);
+
+bool
+Map::updatePath(IncrementalPath & route, Point s, Point e, CreatureH cr, Point & step) const
+{
+    StepOpenFor open(*this, cr.get());
+
+    // a far goal is only planned for as far as the next cluster entrance
+    // on the way. The route through the clusters is searched for once per
+    // destination, and its entrances become the goal in turn as each is
+    // reached. It's searched for again only when one can't be reached
+    Point goal = e;
+    if (isLongRoute(s, e))
+    {
+        goal = route.getGoal();
+        if (!route.isPlanning(m_id, goal) || !(route.getDestination() == e))
+        {
+            HierarchicalPath far;
+            if (!routeFind(s, e, far))
+                return false;
+            route.setWaypoints(far.getWaypoints());
+            goal = s;
         }
+        while (goal == s)
+            if (!route.nextWaypoint(goal))
+                goal = e;
     }
 
-    // we've exhausted all nodes, there mustn't be a path to the target
-    return path;
+    if (!route.isPlanning(m_id, goal))
+    {
+        route.reset(m_id, m_xsize, s, goal);
+    }
+    else
+    {
+        // only squares along the route we're following need repairing
+        route.moveStart(s);
+        std::vector<Point> const & path = route.getPath();
+        for (std::vector<Point>::const_iterator it = path.begin(); it != path.end(); ++it)
+        {
+            if (m_stamps.get(it->x, it->y) > route.getStamp())
+                route.squareChanged(open, *it);
+        }
+    }
+    route.setStamp(m_stamp);
+    route.setDestination(e);
+    if (route.computePath(open) && route.nextStep(step))
+        return true;
+
+    // look for another way to a far goal next time
+    route.setDestination(Point(-1, -1));
+    return false;
 }
-
@@ -5,18 +5,38 @@
 #ifndef H_MAP_
 #define H_MAP_ 1
 
+#include <algorithm>
 #include <cassert>
-#include <list>
+#include <cstdlib>
 #include <map>
 #include <vector>
 
 #include "boost/enable_shared_from_this.hpp"
 #include "boost/noncopyable.hpp"
-
+#include "boost/scoped_ptr.hpp"
+
+#include "actorqueue.h"
+#include "bitplane.h"
+#include "bucketindex.h"
+#include "changejournal.h"
+#include "chunkgrid.h"
+#include "dice.h"
+#include "freecells.h"
 #include "handles.h"
 #include "inputdef.h"
+#include "occupancy.h"
 
 
+class DistanceField;
+class IncrementalPath;
+class LightMap;
+class LOSService;
+class HierarchicalPath;
+class PathFinder;
+class PathHierarchy;
+class PathPool;
+struct PathQuery;
+class Timeline;
 
 class Map : public boost::enable_shared_from_this<Map>,
             private boost::noncopyable
@@ -43,9 +63,25 @@ public:
         Dark, Lit
     };
 
-    typedef std::vector<char> HeroSeen;
+    enum PathMode
+    {
+        AStar, JumpPoint
+    };
+
+    // how squares of the per-square layers are laid out in memory, chosen
+    // when building. Row major unless MAP_TILED_LAYOUT or MAP_ZORDER_LAYOUT
+#if defined(MAP_ZORDER_LAYOUT)
+    typedef ZOrderLayout GridLayout;
+#elif defined(MAP_TILED_LAYOUT)
+    typedef TiledLayout GridLayout;
+#else
+    typedef RowMajorLayout GridLayout;
+#endif
+
+    typedef ChunkedGrid<char, GridLayout> HeroSeen;
     typedef std::vector<char> TerrainTemplate;
     typedef std::map<char, Terrain> TerrainMapping;
+    typedef ChunkSource<Terrain> TerrainSource;
 
     /**
      * Creates a blank default map
@@ -67,21 +103,34 @@ public:
      */
     Map(int x, int y, char const *tmplt, TerrainMapping const & tmk);
 
+    /**
+     * Creates a map whose terrain is generated a chunk at a time. Chunks
+     * are only kept in memory while in use, and any whose terrain has not
+     * been changed are generated again rather than saved when evicted.
+     *
+     * @param x      width of map
+     * @param y      height of map
+     * @param src    terrain generator
+     */
+    Map(int x, int y, boost::shared_ptr<TerrainSource const> src);
+
+    ~Map();
+
     /**
      * Get Terrain at coordinate
      *
-     * @param c      Coords struct of coordinates
+     * @param c      coordinates
      * @return       Terrain type at position
      */
-    Terrain getTerrain(Coords c) const;
+    Terrain getTerrain(Point c) const;
 
     /**
      * Get the name of the Terrain at coordinate
      *
-     * @param c      Coords struct of coordinates
+     * @param c      coordinates
      * @return       name of terrain at position
      */
-    std::string const & getTerrainName(Coords c) const;
+    std::string const & getTerrainName(Point c) const;
 
     /**
      * Set the terrain at coordinate
@@ -89,7 +138,7 @@ public:
      * @param c      coordinates
      * @param t      type of terrain
      */
-    void setTerrain(Coords c, Terrain t);
+    void setTerrain(Point c, Terrain t);
 
     /**
      * Gets the creature inhabiting position
@@ -97,15 +146,82 @@ public:
      * @param c      coordinates
      * @return       Creature or CreatureH() if none exists
      */
-    CreatureH getCreature(Coords c) const;
+    CreatureH getCreature(Point c) const;
+
+    /**
+     * Gets every creature on the map
+     *
+     * @param out    cleared, then filled with the creatures
+     */
+    void getCreatures(std::vector<CreatureH> & out) const;
+
+    /**
+     * Visit every creature no further than radius in a straight line.
+     * Creatures are found through buckets of nearby squares, so this costs
+     * only as much as the area searched. The visitor is called as
+     * bool(CreatureH const & cr, Point at), and returning false stops
+     * the search. Creatures must not be added, moved or removed meanwhile.
+     *
+     * @param c      centre
+     * @param radius distance
+     * @param v      visitor
+     * @return       false if the visitor stopped early
+     */
+    template<typename Visitor>
+    bool visitCreaturesInRadius(Point c, int radius, Visitor & v) const;
 
     /**
-     * Get ItemPile at location
+     * Visit every creature within a rectangle, as visitCreaturesInRadius()
+     *
+     * @param tl     top left corner, inclusive
+     * @param br     bottom right corner, inclusive
+     * @param v      visitor
+     * @return       false if the visitor stopped early
+     */
+    template<typename Visitor>
+    bool visitCreaturesInRect(Point tl, Point br, Visitor & v) const;
+
+    /**
+     * Visit every creature at least inner and no more than outer away in a
+     * straight line, as visitCreaturesInRadius()
+     *
+     * @param c      centre
+     * @param inner  least distance
+     * @param outer  greatest distance
+     * @param v      visitor
+     * @return       false if the visitor stopped early
+     */
+    template<typename Visitor>
+    bool visitCreaturesInRing(Point c, int inner, int outer, Visitor & v) const;
+
+    /**
+     * Get ItemPile at location, for looking at. Nothing is allocated: a
+     * square without a pile gives a single empty pile shared by every Map,
+     * which must not have items added to it (use addItem() or
+     * openItemPile() instead).
+     *
+     * @param  c     coordinates
+     * @return       ItemPile, or the shared empty pile
+     */
+    ItemPileH getItemPile(Point c) const;
+
+    /**
+     * Get ItemPile at location for putting things in, creating it if need
+     * be. If it is left empty, reclaimItemPile() should be called. This is
+     * journalled as a change to the pile.
      *
      * @param  c     coordinates
-     * @return       ItemPile or ItemPileH() if empty
+     * @return       ItemPile belonging to the square
      */
-    ItemPileH getItemPile(Coords c) const;
+    ItemPileH openItemPile(Point c);
+
+    /**
+     * Remove the pile at location if it has no items left
+     *
+     * @param  c     coordinates
+     * @return       true if a pile was removed
+     */
+    bool reclaimItemPile(Point c);
 
     /**
      * Add an Item to pile at location
@@ -114,7 +230,7 @@ public:
      * @param  item  item to add
      * @return       ItemPile containing item
      */
-    ItemPileH addItem(Coords c, ItemH item);
+    ItemPileH addItem(Point c, ItemH item);
 
     /**
      * Add a whole ItemPile to location
@@ -123,30 +239,51 @@ public:
      * @param  itemp ItemPile to add
      * @return       ImtemPile containing put pile
      */
-    ItemPileH addItemPile(Coords c, ItemPileH itemp);
+    ItemPileH addItemPile(Point c, ItemPileH itemp);
 
     /**
-     * Remove an Item from pile
+     * Remove an Item from pile. A pile left empty is reclaimed.
      *
      * @param  c     coordinates
      * @param  item  item to remove
-     * @return       ItemPile remaining
+     * @return       ItemPile remaining, or the shared empty pile
      */
-    ItemPileH delItem(Coords c, ItemH item);
+    ItemPileH delItem(Point c, ItemH item);
 
     /**
      * Remove the whole pile
      * @param  c     coordinates
      * @return       ItemPile removed
      */
-    ItemPileH delItemPile(Coords c);
+    ItemPileH delItemPile(Point c);
+
+    /**
+     * Number of squares holding an ItemPile
+     *
+     * @return       piles
+     */
+    std::size_t getItemPileCount() const;
+
+    /**
+     * Number of ItemPile slots allocated, in use or free for reuse
+     *
+     * @return       slots
+     */
+    std::size_t getItemPileSlots() const;
+
+    /**
+     * Number of empty piles reclaimed since the Map was made
+     *
+     * @return       piles reclaimed
+     */
+    unsigned long getItemPilesReclaimed() const;
 
     /**
      * Get size of map
      *
      * @return       coords representing size of map
      */
-    Coords getSize() const;
+    Point getSize() const;
 
     /**
      * Add a Creature to map
@@ -154,15 +291,24 @@ public:
      * @param  c    coordinates
      * @param  cr   Creature to add
      */
-    void addCreature(Coords c, CreatureH cr);
+    void addCreature(Point c, CreatureH cr);
 
     /**
      * Add a Creature to a pre-determined position
      *
      * @param pos   Position to add to (or near-enough)
      * @param cr    Creature to add
+     * @return      false (and not added) if there is nowhere free
+     */
+    bool addCreature(Position pos, CreatureH cr);
+
+    /**
+     * Pick a passable square with no creature in it at random
+     *
+     * @param out   set to square picked
+     * @return      false (and out unchanged) if there are none
      */
-    void addCreature(Position pos, CreatureH cr);
+    bool getRandomFreeSquare(Point & out) const;
 
     /**
      * Remove a creature from map
@@ -170,7 +316,7 @@ public:
      * @param  c    coordinates
      * @return      Creature removed
      */
-    CreatureH delCreature(Coords c);
+    CreatureH delCreature(Point c);
 
     /**
      * Move a Creature from current location to new
@@ -178,7 +324,7 @@ public:
      * @param  c    new coordinates
      * @param  cr   creature to move
      */
-    void moveCreature(Coords c, CreatureH cr);
+    void moveCreature(Point c, CreatureH cr);
 
     /**
      * Can a creature pass through space
@@ -187,7 +333,7 @@ public:
      * @param  cr   Creature to try
      * @return      true if can pass through
      */
-    bool isPassable(Coords c, CreatureH cr) const;
+    bool isPassable(Point c, CreatureH cr) const;
 
     /**
      * Can a creature see through space?
@@ -196,7 +342,32 @@ public:
      * @param  cr   creature to try
      * @return      true if can see through
      */
-    bool blocksVision(Coords c, CreatureH cr) const;
+    bool blocksVision(Point c, CreatureH cr) const;
+
+    /**
+     * Squares a creature could stand on, were they empty. Kept up to date
+     * as terrain changes. The route hierarchy copies it whole and reads
+     * cluster borders a word (64 squares) at a time. Unlike terrain this
+     * and the other planes are never chunked: they are one bit for every
+     * square of the Map, always in memory.
+     *
+     * @return      passable squares
+     */
+    Bitplane const & getPassablePlane() const { return m_passable; }
+
+    /**
+     * Squares which block line of sight
+     *
+     * @return      opaque squares
+     */
+    Bitplane const & getOpaquePlane() const { return m_opaque; }
+
+    /**
+     * Squares with a creature in
+     *
+     * @return      occupied squares
+     */
+    Bitplane const & getOccupiedPlane() const { return m_occupied; }
 
     /**
      * Get display Representation of space
@@ -205,7 +376,7 @@ public:
      * @param cr    creature to try
      * @return      display Representation of space
      */
-    Representation getRepresentation(Coords c, CreatureH cr);
+    Representation getRepresentation(Point c, CreatureH cr);
 
     /**
      * Returns Manhattan Distance (square blocks) from a to b
@@ -214,7 +385,7 @@ public:
      * @param  b    second coordinates
      * @return      square-block distance
      */
-    static int ManhattanDistance(Coords a, Coords b);
+    static int ManhattanDistance(Point a, Point b);
 
     /**
      * Returns typical roguelike distance (diagonal and orthagonal are equivalent)
@@ -222,7 +393,7 @@ public:
      * @param  b   second coordinate
      * @return     distance
      */
-    static int RoguelikeDistance(Coords a, Coords b);
+    static int RoguelikeDistance(Point a, Point b);
 
     /**
      * Returns vector of coordinates from A to B in a straight line
@@ -231,7 +402,43 @@ public:
      * @param  b    second coordinates
      * @return      vector of coordinates (including origin)
      */
-    static std::vector<Coords> TraceLineFromAtoB(Coords a, Coords b);
+    static std::vector<Point> TraceLineFromAtoB(Point a, Point b);
+
+    /**
+     * Visit the squares of TraceLineFromAtoB() in order, without building
+     * the line. The visitor bool(Point at) returns false to stop.
+     *
+     * @param  a    first coordinates, visited first
+     * @param  b    second coordinates, visited last
+     * @param  v    visitor
+     * @return      false if the visitor stopped early
+     */
+    template<typename Visitor>
+    static bool VisitLineFromAtoB(Point a, Point b, Visitor & v);
+
+    /**
+     * Visit the lines from one square to many, as VisitLineFromAtoB(), such
+     * as the rays of a spell cast over an area. The visitor
+     * bool(std::size_t ray, Point at) is given the index in ends of the
+     * line being followed, and returns false to stop following that one.
+     *
+     * @param  a    first coordinates of every line
+     * @param  ends second coordinates of each line
+     * @param  v    visitor
+     */
+    template<typename Visitor>
+    static void VisitLinesFrom(Point a, std::vector<Point> const & ends, Visitor & v);
+
+    /**
+     * Follow the line from a toward b until it reaches b, an opaque
+     * square or the edge of the map, as a missile or a bolt would
+     *
+     * @param  a    first coordinates, on the map
+     * @param  b    second coordinates
+     * @return      b, the first opaque square after a, or the last square
+     *              on the map if the line leaves it first
+     */
+    Point traceToOpaque(Point a, Point b) const;
 
     /**
      * Get the Actor next allowed to act()
@@ -240,6 +447,43 @@ public:
      */
     ActorH getNextActor() const;
 
+    /**
+     * Get the turn of the Actor next allowed to act()
+     *
+     * @return      turn, or the largest turn if there are no Actors
+     */
+    unsigned int getNextTurn() const;
+
+    /**
+     * Report changes of the next Actor to a Timeline. Set by the Timeline
+     * itself as the Map is added and removed.
+     *
+     * @param tl     timeline to notify, or 0 for none
+     */
+    void setTimeline(Timeline *tl);
+
+    /**
+     * Get the Map's identifier, which no other Map in this run shares
+     *
+     * @return       identifier
+     */
+    MapId getId() const;
+
+    /**
+     * Is the hero on this map?
+     *
+     * @return       true if a creature with a hero GUID is here
+     */
+    bool hasHero() const;
+
+    /**
+     * The Map's own random number stream. Its Actors draw from it while they
+     * act, so each Map's results depend only on what happens on that Map.
+     *
+     * @return       this Map's Dice
+     */
+    Dice & getDice();
+
     /**
      * Update actor time
      *
@@ -248,6 +492,61 @@ public:
      */
     void updateActor(ActorH act, unsigned int nt);
 
+    /**
+     * Bring every creature due to act before turn up to it, as though each
+     * had spent the time acting at its own speed
+     *
+     * @param turn   first turn creatures may act on again
+     */
+    void skipToTurn(unsigned int turn);
+
+    /**
+     * Can a creature at one square see another? Sight follows the line of
+     * TraceLineFromAtoB(), the same both ways round, and is blocked only by
+     * opaque squares between the two. Answers are remembered until the
+     * terrain changes.
+     *
+     * @param a      one square
+     * @param b      other square
+     * @param radius how far can be seen, in a straight line
+     * @return       true if b is no further than radius and in sight
+     */
+    bool canSee(Point a, Point b, int radius) const;
+
+    /**
+     * canSee() for many viewers of one square at once, such as every
+     * monster on the map looking for the hero in a turn
+     *
+     * @param from   viewers
+     * @param to     square looked at
+     * @param radius how far each viewer can see
+     * @param out    resized to from, then set to 1 where from[i] sees to
+     */
+    void canSeeMany(std::vector<Point> const & from, Point to, int radius,
+                    std::vector<char> & out) const;
+
+    /**
+     * Have every creature near the hero look for them at once, through
+     * canSeeMany(). canSeeHero() answers from these sightings until the
+     * hero moves or the terrain changes. The World calls this after each
+     * of the hero's turns.
+     *
+     * @param hero   hero's square
+     * @param radius how far any creature can see
+     */
+    void lookForHero(Point hero, int radius);
+
+    /**
+     * canSee() from a creature to the hero, answered from the sightings of
+     * the last lookForHero() where they cover the creature's square
+     *
+     * @param c      creature's square
+     * @param hero   hero's square
+     * @param radius how far the creature can see
+     * @return       true if the hero is no further than radius and in sight
+     */
+    bool canSeeHero(Point c, Point hero, int radius) const;
+
     /**
      * Find a path from start to end using creature mobility
      * @param s      beginning
@@ -255,9 +554,193 @@ public:
      * @param cr     creature to pathfind
      * @return       vector of coordinates to follow
      */
-    std::vector<Coords> pathFind(Coords s, Coords e, CreatureH cr) const;
-    
+    std::vector<Point> pathFind(Point s, Point e, CreatureH cr) const;
+
+    /**
+     * Find a path from start to end into a caller-supplied buffer. The
+     * search itself uses the Map's reusable PathFinder, so if the buffer
+     * is kept between calls no allocation takes place. The path is as
+     * short as any, and goes around creatures, unless a route distance
+     * has been set with setRouteDistance(): then ends further apart than
+     * that are joined through routeFind() instead. Such paths may be a
+     * few percent longer, and pass through creatures, which will usually
+     * have moved on by the time they're reached.
+     *
+     * @param s      beginning
+     * @param e      end position
+     * @param cr     creature to pathfind
+     * @param path   cleared, then filled with coordinates to follow
+     * @return       true if a path was found
+     */
+    bool pathFind(Point s, Point e, CreatureH cr, std::vector<Point> & path) const;
+
+    /**
+     * Choose how pathFind() searches. Every square costs the same to enter,
+     * so JumpPoint finds paths just as short as AStar, while putting far
+     * fewer squares on the open list in wide open areas.
+     *
+     * @param mode   AStar (the default) or JumpPoint
+     */
+    void setPathMode(PathMode mode);
+
+    /**
+     * Choose how far apart, in a straight line, the ends of a query to
+     * pathFind() or updatePath() must be for it to go through the cluster
+     * hierarchy of routeFind(). Off by default; a map large enough for
+     * searches across it to hurt should set it to two clusters (32) or so.
+     *
+     * @param distance  squares, or 0 (the default) to always search
+     *                  square by square
+     */
+    void setRouteDistance(int distance);
+
+    /**
+     * Solve a batch of path queries at once on the shared pool of path
+     * threads. Every query reads the Map's passable and occupied planes,
+     * which nothing changes until all are done, so results are the same as
+     * calling pathFind() for each in turn with no route distance set.
+     *
+     * @param queries each has its path buffer cleared then filled, and
+     *                found set, just as pathFind() would
+     */
+    void pathFindMany(std::vector<PathQuery> & queries) const;
+
+    /**
+     * Get the next step for a creature chasing the hero. Every chaser on
+     * the map shares one distance field toward the hero, which is rebuilt
+     * on the first request after the hero moves or the terrain changes.
+     *
+     * @param c      position of chasing creature
+     * @param step   set to the square to move to. If every square nearer
+     *               the hero is occupied this is c itself
+     * @return       false if there is no hero on the map or c cannot reach it
+     */
+    bool chaseStep(Point c, Point & step) const;
+
+    /**
+     * Find a long route through the Map's cluster hierarchy. Only entrances
+     * between clusters are searched, so this is much cheaper than pathFind()
+     * across a large map, at the price of routes a few percent longer.
+     * Creatures are not obstacles; routeStep() goes around them.
+     *
+     * @param s      beginning
+     * @param e      end position
+     * @param route  filled with the abstract route
+     * @return       true if a route was found
+     */
+    bool routeFind(Point s, Point e, HierarchicalPath & route) const;
+
+    /**
+     * Take the next square of a route from routeFind(). A creature which
+     * is not where its last step led takes up the route from where it is.
+     * A step which has been walled up or is occupied is gone around within
+     * its cluster where possible.
+     *
+     * @param route  route being followed
+     * @param c      position of the creature following it
+     * @param step   set to the next square, or to c to wait for a creature
+     *               in the way to move
+     * @return       false when the route is finished, or can't be followed
+     *               from c because the terrain has changed
+     */
+    bool routeStep(HierarchicalPath & route, Point c, Point & step) const;
+
+    /**
+     * Bring a creature's persistent route up to date. The route is planned
+     * from scratch only when its goal or map has changed. Otherwise only
+     * squares on the cached route which have changed since it was last
+     * checked (terrain set, or a creature arriving or leaving) are repaired.
+     * A goal beyond the route distance, if one is set, is planned for only
+     * as far as the next cluster entrance routeFind() passes through on
+     * the way, which is kept until it's reached.
+     *
+     * @param route  route kept by the creature between turns
+     * @param s      creature's current position
+     * @param e      goal
+     * @param cr     creature following the route (not an obstacle to itself)
+     * @param step   set to the next square of the route
+     * @return       true if the goal is reachable
+     */
+    bool updatePath(IncrementalPath & route, Point s, Point e, CreatureH cr, Point & step) const;
+
+    /**
+     * Get the stamp of the last change to a square's terrain or occupant.
+     * Every change to the map takes a new, higher stamp.
+     *
+     * @param c      coordinates
+     * @return       change stamp (0 for never changed)
+     */
+    unsigned int getSquareStamp(Point c) const;
+
+    /**
+     * Free the memory held by all but the most recently used chunks of
+     * terrain, of what the hero has seen and of change stamps. Changed
+     * chunks go to a compressed file, and are read back in when next
+     * touched.
+     *
+     * @param keep   chunks of each layer to leave in memory
+     * @return       number of chunks evicted
+     */
+    std::size_t evictChunks(std::size_t keep);
+
+    /**
+     * Size of the file holding evicted chunks which had been changed
+     *
+     * @return       bytes
+     */
+    long getChunkCacheBytes() const;
+
+    /**
+     * Memory held by the chunks of every chunked layer now in memory.
+     * The bit planes and the set of free squares aren't counted; they
+     * always hold four bits for every square
+     *
+     * @return       bytes
+     */
+    long getResidentChunkBytes() const;
+
+    /**
+     * Get the coloured light cast over the Map by torches, lava and the
+     * like. Whoever draws the Map calls LightMap::update() first.
+     *
+     * @return       light map, made dark on first use
+     */
+    LightMap & getLightMap();
+
+    /**
+     * Get the version of the Map. It goes up by one for each change to
+     * terrain, to a pile of items, and for each creature arriving on or
+     * leaving a square.
+     *
+     * @return       version
+     */
+    unsigned long getVersion() const;
+
+    /**
+     * Get the version of the Map as of the last change to terrain. Those
+     * keeping only what depends on terrain up to date need not look at
+     * creatures' comings and goings.
+     *
+     * @return       version, 0 if the terrain has not changed
+     */
+    unsigned long getTerrainVersion() const { return m_terrain_version; }
+
+    /**
+     * Get what has changed since a version. Only the most recent changes
+     * are kept, so a caller too far behind has to rescan the map.
+     *
+     * @param version last version seen
+     * @param out     cleared, then filled with changes, oldest first
+     * @return        false if the changes are no longer all kept
+     */
+    bool getChangesSince(unsigned long version, std::vector<MapChange> & out) const;
+
 
+    /**
+     * Make every square Dark again. Squares hold the generation they were
+     * last lit in, so this just starts a new generation and costs nothing
+     * however large the map.
+     */
     void clearSeenGrid();
 
     void setSeenGrid(int x, int y, Lighting lit);
@@ -269,27 +752,67 @@ public:
     char getHeroSeenChar(int x, int y) const;
 
 private:
-    bool insideBoundaries(Coords c) const;
-    unsigned long xyToHash(Coords c) const;
-    unsigned long xyToHash(int x, int y) const;
-    Coords hashToXY(unsigned long hash) const;
+    bool insideBoundaries(Point c) const;
     void setTerrain(int x, int y, Terrain t);
     ItemPileH addItem(int x, int y,  ItemH item);
     void addCreature(int x, int y, CreatureH cr);
     Representation getTerrainRep(int x, int y) const;
-
-    typedef std::vector<Lighting> SeenGrid;
-    typedef std::vector<Map::Terrain> Grid;
-    typedef std::map<unsigned long, CreatureH> Creatures;
-    typedef std::map<unsigned long, ItemPileH> ItemPiles;
-    typedef std::list<ActorH> Actors;
-
-    Actors m_actors;
+    bool isOpenSquare(int x, int y) const;
+    bool isPassableSquare(int x, int y) const;
+    bool isOpenSquareFor(int x, int y, Creature const *cr) const;
+    bool isLongRoute(Point s, Point e) const;
+    bool routePath(Point s, Point e, std::vector<Point> & path) const;
+    void touchSquare(int x, int y);
+    void headChanged() const;
+
+    template<typename Visitor> struct VisitCreature;
+    template<typename Visitor> struct VisitRay;
+    struct StopAtOpaque;
+    struct GatherLookers;
+    struct StepOpen;
+    struct StepOpenFor;
+    struct StepPassable;
+
+    typedef ChunkedGrid<unsigned int, GridLayout> SeenGrid;
+    typedef ChunkedGrid<unsigned int, GridLayout> StampGrid;
+    typedef ChunkedGrid<Map::Terrain, GridLayout> Grid;
+    typedef OccupancyLayer<CreatureH> Creatures;
+    typedef OccupancyLayer<ItemPileH> ItemPiles;
+
+    MapId m_id;
+    ActorQueue m_actors;
+    Timeline *m_timeline;
+    Dice m_dice;
     Grid m_grid;
     SeenGrid m_seengrid;
+    unsigned int m_seen_generation;
     HeroSeen m_heroseen;
     Creatures m_creatures;
-    mutable ItemPiles m_itempiles;
+    BucketIndex m_creature_buckets;
+    ItemPiles m_itempiles;
+    unsigned long m_piles_reclaimed;
+    Bitplane m_passable;
+    Bitplane m_opaque;
+    Bitplane m_occupied;
+    FreeCells m_free;
+    mutable boost::scoped_ptr<PathFinder> m_pathfinder;
+    PathMode m_pathmode;
+    int m_route_distance;
+    mutable boost::scoped_ptr<DistanceField> m_chasefield;
+    mutable boost::scoped_ptr<PathHierarchy> m_hierarchy;
+    mutable boost::scoped_ptr<LOSService> m_los;
+    boost::scoped_ptr<LightMap> m_lights;
+    Point m_chase_target;
+    mutable bool m_chase_dirty;
+    std::vector<Point> m_lookers;
+    std::vector<char> m_sighted;
+    Point m_sighted_hero;
+    int m_sighted_radius;
+    unsigned long m_sighted_version;
+    StampGrid m_stamps;
+    unsigned int m_stamp;
+    ChangeJournal m_journal;
+    unsigned long m_terrain_version;
 
     int m_xsize;
     int m_ysize;
@@ -297,6 +820,102 @@ private:
 };
 
 
+template<typename Visitor>
+struct Map::VisitCreature
+{
+    VisitCreature(Map const & mp, Visitor & vis) : map(mp), v(vis) {}
+    bool operator()(Point at) { return v(map.m_creatures.get(at.Y() * map.m_xsize + at.X()), at); }
+    Map const & map;
+    Visitor & v;
+};
+
+
+template<typename Visitor>
+bool
+Map::visitCreaturesInRadius(Point c, int radius, Visitor & v) const
+{
+    VisitCreature<Visitor> visit(*this, v);
+    return m_creature_buckets.visitRadius(c, radius, visit);
+}
+
+
+template<typename Visitor>
+bool
+Map::visitCreaturesInRect(Point tl, Point br, Visitor & v) const
+{
+    VisitCreature<Visitor> visit(*this, v);
+    return m_creature_buckets.visitRect(tl, br, visit);
+}
+
+
+template<typename Visitor>
+bool
+Map::visitCreaturesInRing(Point c, int inner, int outer, Visitor & v) const
+{
+    VisitCreature<Visitor> visit(*this, v);
+    return m_creature_buckets.visitRing(c, inner, outer, visit);
+}
+
+
+//! Bresenham line algorithm
+//  from http://en.wikipedia.org/wiki/Bresenham's_line_algorithm
+template<typename Visitor>
+bool
+Map::VisitLineFromAtoB(Point a, Point b, Visitor & v)
+{
+    bool const steep = std::abs(b.y - a.y) > std::abs(b.x - a.x);
+    if (steep)
+    {
+        std::swap(a.x, a.y);
+        std::swap(b.x, b.y);
+    }
+    int const deltax = std::abs(b.x - a.x);
+    int const deltay = std::abs(b.y - a.y);
+    int const xstep = (a.x < b.x) ? 1 : -1;
+    int const ystep = (a.y < b.y) ? 1 : -1;
+    int error = 0;
+    int x = a.x;
+    int y = a.y;
+
+    if (!v(steep ? Point(y, x) : Point(x, y)))
+        return false;
+    while (x != b.x)
+    {
+        x += xstep;
+        error += deltay;
+        if (error * 2 >= deltax)
+        {
+            y += ystep;
+            error -= deltax;
+        }
+        if (!v(steep ? Point(y, x) : Point(x, y)))
+            return false;
+    }
+    return true;
+}
+
+
+template<typename Visitor>
+struct Map::VisitRay
+{
+    VisitRay(Visitor & vis, std::size_t r) : v(vis), ray(r) {}
+    bool operator()(Point at) { return v(ray, at); }
+    Visitor & v;
+    std::size_t ray;
+};
+
+
+template<typename Visitor>
+void
+Map::VisitLinesFrom(Point a, std::vector<Point> const & ends, Visitor & v)
+{
+    for (std::size_t i = 0; i < ends.size(); ++i)
+    {
+        VisitRay<Visitor> ray(v, i);
+        VisitLineFromAtoB(a, ends[i], ray);
+    }
+}
+
 
 
 #endif
@@ -0,0 +1,132 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#include <cassert>
+#include <exception>
+
+#include "boost/bind.hpp"
+
+#include "actor.h"
+#include "dice.h"
+#include "error.h"
+#include "map.h"
+#include "maprunner.h"
+
+//============================================================================
+// MapRunner
+//============================================================================
+MapRunner::MapRunner(int threads) :
+    m_start(threads + 1),
+    m_finish(threads + 1),
+    m_mutex(),
+    m_threads(),
+    m_maps(0),
+    m_next(0),
+    m_turn(0),
+    m_stop(false),
+    m_failed(false),
+    m_failure()
+{
+    for (int i = 0; i < threads; ++i)
+        m_threads.create_thread(boost::bind(&MapRunner::work, this));
+}
+
+
+MapRunner::~MapRunner()
+{
+    m_stop = true;
+    m_start.wait();
+    m_threads.join_all();
+}
+
+
+void
+MapRunner::run(std::vector<Map *> const & maps, unsigned int turn)
+{
+    m_maps = &maps;
+    m_next = 0;
+    m_turn = turn;
+    m_failed = false;
+    m_start.wait();
+    drain();
+    m_finish.wait();
+    m_maps = 0;
+
+    if (m_failed)
+    {
+        Error<ThreadE> err("Actor failed on a background thread: ");
+        err << m_failure;
+        throw err;
+    }
+}
+
+
+void
+MapRunner::work()
+{
+    for (;;)
+    {
+        m_start.wait();
+        if (m_stop)
+            return;
+        drain();
+        m_finish.wait();
+    }
+}
+
+
+// every thread must reach the finish barrier, so nothing thrown by an
+// Actor may leave here. The first failure is kept for run() to throw
+void
+MapRunner::drain()
+{
+    for (;;)
+    {
+        Map *mp;
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+            if (m_failed || m_next >= m_maps->size())
+                return;
+            mp = (*m_maps)[m_next++];
+        }
+
+        std::string what;
+        try
+        {
+            Advance(*mp, m_turn);
+            continue;
+        }
+        catch (std::exception const & e)
+        {
+            what = e.what();
+        }
+        catch (...)
+        {
+            what = "unknown exception";
+        }
+
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+            if (!m_failed)
+            {
+                m_failed = true;
+                m_failure = what;
+            }
+        }
+    }
+}
+
+
+void
+MapRunner::Advance(Map & mp, unsigned int turn)
+{
+    Dice::Stream stream(mp.getDice());
+    while (mp.getNextTurn() <= turn)
+    {
+        ActorH actor = mp.getNextActor();
+        unsigned int const nt = actor->act();
+        assert(actor->getCoords().M().get() == &mp && "Actor left its Map while in the background");
+        mp.updateActor(actor, nt);
+    }
+}
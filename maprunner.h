@@ -0,0 +1,80 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#ifndef H_MAPRUNNER_
+#define H_MAPRUNNER_ 1
+
+#include <string>
+#include <vector>
+
+#include "boost/noncopyable.hpp"
+#include "boost/thread/barrier.hpp"
+#include "boost/thread/mutex.hpp"
+#include "boost/thread/thread.hpp"
+
+class Map;
+
+
+/**
+ * MapRunner brings whole Maps up to a turn on a fixed set of worker
+ * threads, for World::setBackgroundThreads(). Each run() is one round: all
+ * threads meet at a start barrier, share out the maps one at a time, and
+ * meet again at a finish barrier before run() returns. Every Actor draws
+ * from its own Map's Dice, so the results are the same with any number of
+ * threads. Only one thread may call run() at a time.
+ */
+class MapRunner : private boost::noncopyable
+{
+public:
+    /**
+     * Start the workers
+     *
+     * @param threads  number of threads besides the caller's own
+     */
+    explicit MapRunner(int threads);
+
+    /**
+     * Stop and join the workers
+     */
+    ~MapRunner();
+
+    /**
+     * Advance each map with Advance(). If an Actor throws, no more maps
+     * are handed out, and once every thread has finished the failure is
+     * thrown again here as an Error<ThreadE>. Maps already taken are left
+     * wherever they had got to.
+     *
+     * @param maps     maps to advance, none sharing Actors with another
+     * @param turn     every Actor due by this turn acts
+     */
+    void run(std::vector<Map *> const & maps, unsigned int turn);
+
+    /**
+     * Have the Actors of one Map act in order until none is due by the
+     * turn, drawing from the Map's Dice
+     *
+     * @param mp       map to advance
+     * @param turn     last turn to act on
+     */
+    static void Advance(Map & mp, unsigned int turn);
+
+private:
+    void work();
+    void drain();
+
+    boost::barrier             m_start;
+    boost::barrier             m_finish;
+    boost::mutex               m_mutex;
+    boost::thread_group        m_threads;
+    std::vector<Map *> const * m_maps;
+    std::size_t                m_next;
+    unsigned int               m_turn;
+    bool                       m_stop;
+    bool                       m_failed;
+    std::string                m_failure;
+};
+
+
+
+#endif
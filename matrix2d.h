@@ -0,0 +1,208 @@
+// -*- Mode: C++ -*-
+// RogueMonkey (c) 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+
+#ifndef H_MATRIX2D_
+#define H_MATRIX2D_ 1
+
+#include <cassert>
+#include <stdexcept>
+#include <vector>
+
+
+/**
+ * Layouts decide where square (x, y) of a Matrix2D lives in its storage.
+ * Each is built for a width and height, says how many elements it needs
+ * (which may be more than width * height, for padding) and maps x and y to
+ * an index.
+ */
+
+/**
+ * Rows one after another: y * width + x. Neighbours along a row are
+ * adjacent, but those above and below are a whole row away.
+ */
+class RowMajorLayout
+{
+public:
+    RowMajorLayout(int x, int y) : m_xsize(x), m_ysize(y) {}
+
+    int index(int x, int y) const { return y * m_xsize + x; }
+    int size() const { return m_xsize * m_ysize; }
+
+private:
+    int m_xsize;
+    int m_ysize;
+};
+
+
+/**
+ * Row major 8x8 tiles, each tile row major inside. All eight neighbours of
+ * a square are usually within the same 64 elements.
+ */
+class TiledLayout
+{
+public:
+    enum
+    {
+        TileShift = 3,
+        TileSide = 1 << TileShift
+    };
+
+    TiledLayout(int x, int y) :
+        m_tiles_x((x + TileSide - 1) >> TileShift),
+        m_tiles_y((y + TileSide - 1) >> TileShift) {}
+
+    int index(int x, int y) const
+    {
+        return (((y >> TileShift) * m_tiles_x + (x >> TileShift)) << (2 * TileShift)) +
+               ((y & (TileSide - 1)) << TileShift) + (x & (TileSide - 1));
+    }
+
+    int size() const { return (m_tiles_x * m_tiles_y) << (2 * TileShift); }
+
+private:
+    int m_tiles_x;
+    int m_tiles_y;
+};
+
+
+/**
+ * Row major 64x64 blocks, each laid out along a Z-order (Morton) curve by
+ * interleaving the bits of x and y. Squares near each other in any
+ * direction are near each other in memory at every scale up to a block.
+ */
+class ZOrderLayout
+{
+public:
+    enum
+    {
+        BlockShift = 6,
+        BlockSide = 1 << BlockShift
+    };
+
+    ZOrderLayout(int x, int y) :
+        m_blocks_x((x + BlockSide - 1) >> BlockShift),
+        m_blocks_y((y + BlockSide - 1) >> BlockShift) {}
+
+    int index(int x, int y) const
+    {
+        return (((y >> BlockShift) * m_blocks_x + (x >> BlockShift)) << (2 * BlockShift)) +
+               Spread(x & (BlockSide - 1)) + (Spread(y & (BlockSide - 1)) << 1);
+    }
+
+    int size() const { return (m_blocks_x * m_blocks_y) << (2 * BlockShift); }
+
+    /**
+     * Put a zero bit between each of the low BlockShift bits of v
+     */
+    static int Spread(int v)
+    {
+        v = (v | (v << 4)) & 0x0f0f;
+        v = (v | (v << 2)) & 0x3333;
+        v = (v | (v << 1)) & 0x5555;
+        return v;
+    }
+
+private:
+    int m_blocks_x;
+    int m_blocks_y;
+};
+
+
+/**
+ * Matrix2D is a fixed size grid of T addressed by (x, y), stored in one
+ * block laid out by Layout. Every layout is reached through the same
+ * accessors, so callers can change layout without changing code.
+ */
+template<typename T, typename Layout = RowMajorLayout>
+class Matrix2D
+{
+public:
+    typedef T                                       value_type;
+    typedef value_type &                            reference;
+    typedef value_type const &                      const_reference;
+    typedef int                                     size_type;
+    typedef Layout                                  layout_type;
+
+    Matrix2D(size_type cols, size_type rows, T const & tmp = T());
+
+    size_type size_x() const { return m_xsize; }
+    size_type size_y() const { return m_ysize; }
+
+    T & operator() (size_type x, size_type y)
+    {
+        assert(x >= 0 && y >= 0 && x < m_xsize && y < m_ysize);
+        return m_data[m_layout.index(x, y)];
+    }
+
+    T const & operator() (size_type x, size_type y) const
+    {
+        assert(x >= 0 && y >= 0 && x < m_xsize && y < m_ysize);
+        return m_data[m_layout.index(x, y)];
+    }
+
+    T & at(size_type x, size_type y);
+    T const & at(size_type x, size_type y) const;
+
+    /**
+     * Set every square
+     *
+     * @param tmp    new value
+     */
+    void fill(T const & tmp);
+
+    /**
+     * Number of elements held, including any padding the layout needs
+     *
+     * @return       elements
+     */
+    std::size_t storage() const { return m_data.size(); }
+
+private:
+    Layout m_layout;
+    std::vector<T> m_data;
+    size_type m_xsize;
+    size_type m_ysize;
+};
+
+
+template<typename T, typename Layout>
+Matrix2D<T, Layout>::Matrix2D(size_type cols, size_type rows, T const & tmp) :
+    m_layout(cols, rows),
+    m_data(m_layout.size(), tmp),
+    m_xsize(cols),
+    m_ysize(rows)
+{
+}
+
+
+template<typename T, typename Layout>
+T &
+Matrix2D<T, Layout>::at(size_type x, size_type y)
+{
+    if (x < 0 || y < 0 || x >= m_xsize || y >= m_ysize)
+        throw std::out_of_range("Matrix2D::at");
+    return m_data[m_layout.index(x, y)];
+}
+
+
+template<typename T, typename Layout>
+T const &
+Matrix2D<T, Layout>::at(size_type x, size_type y) const
+{
+    if (x < 0 || y < 0 || x >= m_xsize || y >= m_ysize)
+        throw std::out_of_range("Matrix2D::at");
+    return m_data[m_layout.index(x, y)];
+}
+
+
+template<typename T, typename Layout>
+void
+Matrix2D<T, Layout>::fill(T const & tmp)
+{
+    m_data.assign(m_data.size(), tmp);
+}
+
+
+#endif
@@ -8,6 +8,7 @@
 #include "hero.h"
 #include "map.h"
 #include "monster.h"
+#include "pathfind.h"
 #include "world.h"
 
 //============================================================================
@@ -27,7 +28,8 @@ Monster::Monster(Species::Type t)
     m_inventory(new ItemPile(52)),
     m_target_cr(),
     m_target_pos(),
-    m_path()
+    m_target_map(0),
+    m_path(new IncrementalPath)
 {
    setTargetPosition(Coords(0, 0));
 }
@@ -92,24 +94,33 @@ Monster::getSightRadius() const
 unsigned int
 Monster::act()
 {  
-//    if (m_path.empty())
-//    {
-        setTargetPosition(HERO->getCoords());
-        updatePathToPosition();
-//    }
-
-    if (m_path.empty())
-        return 1 * Actor::Slow;
-
     Coords here(getCoords());
     CreatureH me(getCreatureHandle());
-    Coords there(m_path.front());
 
-    if (here.M()->isPassable(there, me) && !here.M()->getCreature(there))
+    // while the hero can be seen, follow the map's shared chase field
+    // toward them
+    Coords const hero(HERO->getCoords());
+    Point step;
+    if (hero.M() == here.M() && here.M()->canSeeHero(here, hero, getSightRadius()))
     {
-        here.M()->moveCreature(there, me);
-        m_path.pop_front();
+        setTargetPosition(hero);
+        if (here.M()->chaseStep(here, step))
+        {
+            if (step.X() != here.X() || step.Y() != here.Y())
+                here.M()->moveCreature(step, me);
+            return 1 * Actor::Slow;
+        }
     }
+
+    // otherwise keep following (and repairing) our route to where they
+    // were last seen. Once there, wait to see them again
+    if (m_target_pos == here)
+        m_target_map = 0;
+    if (!updatePathToPosition(step))
+        return 1 * Actor::Slow;
+
+    if (here.M()->isPassable(step, me) && !here.M()->getCreature(step))
+        here.M()->moveCreature(step, me);
     return 1 * Actor::Slow;
 }
 
@@ -228,7 +239,7 @@ Monster::hasSkill(Skills::Type, int lev) const
 }
 
 
-Coords
+Point
 Monster::getTargetPosition() const
 {
     return m_target_pos;
@@ -239,15 +250,17 @@ void
 Monster::setTargetPosition(Coords pos)
 {
     m_target_pos = pos;
+    m_target_map = pos.M() ? pos.M()->getId() : 0;
 }
 
 
-void
-Monster::updatePathToPosition()
+bool
+Monster::updatePathToPosition(Point & step)
 {
     Coords here(getCoords());
-    std::vector<Coords> path(here.M()->pathFind(here, getTargetPosition(), getCreatureHandle()));
-    m_path.assign(path.begin(), path.end());
+    if (here.M()->getId() != m_target_map)
+        return false;
+    return here.M()->updatePath(*m_path, here, m_target_pos, getCreatureHandle(), step);
 }
 
 
@@ -5,9 +5,9 @@
 // RogueMonkey copyright 2007 Adam White theroguemonkey@gmail.com
 // Released under the GPL version 2 - refer to included file LICENCE.txt
 
-#include <deque>
 #include <string>
 
+#include "boost/scoped_ptr.hpp"
 
 #include "creature.h"
 #include "handles.h"
@@ -15,13 +15,16 @@
 #include "species.h"
 
 
+class IncrementalPath;
+
 class Monster : public Creature
 {
     SpeciesH            m_species;
     ItemPileH           m_inventory;
     CreatureH           m_target_cr;
-    Coords              m_target_pos;
-    std::deque<Coords>  m_path;
+    Point               m_target_pos;
+    MapId               m_target_map;
+    boost::scoped_ptr<IncrementalPath> m_path;
 
     explicit Monster(Species::Type t);
 
@@ -178,8 +181,15 @@ public:
     };
 
     void setTargetPosition(Coords pos);
-    Coords getTargetPosition() const;
-    void updatePathToPosition();
+    Point getTargetPosition() const;
+
+    /**
+     * Follow the route to the target position. The route is kept between
+     * turns and only repaired where the map has changed along it.
+     * @param step       set to the next square of the route
+     * @return           false if the target is on another map or can't be reached
+     */
+    bool updatePathToPosition(Point & step);
     
 };
 
@@ -0,0 +1,181 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#ifndef H_OCCUPANCY_
+#define H_OCCUPANCY_ 1
+
+#include <vector>
+
+#include "boost/noncopyable.hpp"
+
+
+/**
+ * OccupancyLayer holds at most one T per square of a grid. Squares are
+ * split by index into pages, and a page only has an array while something
+ * is on it. There every square has an int which is either -1 or the index
+ * of a slot holding its occupant, so finding out whether (and by what) a
+ * square is occupied is two array loads. Freed slots are reused before the
+ * slot array grows.
+ *
+ * Squares are addressed by index, y * width + x.
+ */
+template<typename T>
+class OccupancyLayer : private boost::noncopyable
+{
+public:
+    /**
+     * Create an empty layer
+     *
+     * @param squares  number of squares in grid
+     */
+    explicit OccupancyLayer(int squares) :
+        m_pages((squares + PageSquares - 1) >> PageShift), m_slots(), m_free(), m_none() {}
+
+    /**
+     * Is a square occupied?
+     *
+     * @param index    square
+     * @return         true if there is an occupant
+     */
+    bool occupied(int index) const { return slotOf(index) >= 0; }
+
+    /**
+     * The occupant of a square
+     *
+     * @param index    square
+     * @return         occupant, or T() if none
+     */
+    T const & get(int index) const
+    {
+        int const slot = slotOf(index);
+        return slot < 0 ? m_none : m_slots[slot];
+    }
+
+    /**
+     * Occupy an empty square
+     *
+     * @param index    square
+     * @param value    occupant
+     * @return         false (and nothing changed) if already occupied
+     */
+    bool insert(int index, T const & value);
+
+    /**
+     * Empty a square
+     *
+     * @param index    square
+     * @return         former occupant, or T() if none
+     */
+    T take(int index);
+
+    /**
+     * Number of occupied squares
+     *
+     * @return         occupants
+     */
+    std::size_t size() const { return m_slots.size() - m_free.size(); }
+
+    /**
+     * Number of slots allocated, occupied or free
+     *
+     * @return         slots
+     */
+    std::size_t capacity() const { return m_slots.size(); }
+
+    /**
+     * Every occupant, in slot order
+     *
+     * @param out      cleared, then filled with occupants
+     */
+    void collect(std::vector<T> & out) const;
+
+private:
+    enum
+    {
+        PageShift = 8,
+        PageSquares = 1 << PageShift
+    };
+
+    struct Page
+    {
+        Page() : cells(), count(0) {}
+
+        std::vector<int> cells;     // empty while nothing is on the page
+        int              count;     // occupied squares
+    };
+
+    int slotOf(int index) const
+    {
+        Page const & page = m_pages[index >> PageShift];
+        return page.cells.empty() ? -1 : page.cells[index & (PageSquares - 1)];
+    }
+
+    std::vector<Page> m_pages;
+    std::vector<T>   m_slots;
+    std::vector<int> m_free;
+    T const          m_none;
+};
+
+
+template<typename T>
+bool
+OccupancyLayer<T>::insert(int index, T const & value)
+{
+    Page & page = m_pages[index >> PageShift];
+    if (page.cells.empty())
+        page.cells.assign(PageSquares, -1);
+    int & cell = page.cells[index & (PageSquares - 1)];
+    if (cell >= 0)
+        return false;
+    if (m_free.empty())
+    {
+        cell = static_cast<int>(m_slots.size());
+        m_slots.push_back(value);
+    }
+    else
+    {
+        cell = m_free.back();
+        m_free.pop_back();
+        m_slots[cell] = value;
+    }
+    ++page.count;
+    return true;
+}
+
+
+template<typename T>
+T
+OccupancyLayer<T>::take(int index)
+{
+    int const slot = slotOf(index);
+    if (slot < 0)
+        return T();
+    T value(m_slots[slot]);
+    m_slots[slot] = T();
+    m_free.push_back(slot);
+
+    // the last to leave a page takes its array with it
+    Page & page = m_pages[index >> PageShift];
+    if (--page.count == 0)
+        std::vector<int>().swap(page.cells);
+    else
+        page.cells[index & (PageSquares - 1)] = -1;
+    return value;
+}
+
+
+template<typename T>
+void
+OccupancyLayer<T>::collect(std::vector<T> & out) const
+{
+    out.clear();
+    out.reserve(size());
+    for (typename std::vector<T>::const_iterator it = m_slots.begin(); it != m_slots.end(); ++it)
+        if (*it)
+            out.push_back(*it);
+}
+
+
+
+#endif
@@ -2,8 +2,11 @@
 // RogueMonkey (c) 2008 Adam White theroguemonkey@gmail.com
 // Released under the GPL version 2 - refer to included file LICENCE.txt
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
 #include <string>
+#include <vector>
 
 #include "dice.h"
 #include "dmutils.h"
@@ -35,6 +38,7 @@ public:
     Overworld(std::string const & name) :
         DungeonMaster(name)
     {
+        setLevelSize(mapsz_x, mapsz_y);
     }
 
     virtual ~Overworld()
@@ -71,50 +75,17 @@ public:
         return Actor::Fast;
     }
 
-    MapH createLevel(int /*lvl*/, int /*x*/, int /*y*/)
+    MapH createLevel(int /*lvl*/, int size_x, int size_y)
     {
-        Vertices heightmap((mapsz_x + 1) * (mapsz_y + 1), 0);
-        int rnd = begin_rand;
-
-        for (int step = mapsz_x; step > 1; step = (step + 1) / 2 - 1)
-        {
-            for (int y = 0; y < mapsz_y - 2; y += step)
-            {
-                for (int x = 0; x < mapsz_x - 2; x += step)
-                {
-                    GenMidpoints(heightmap, x, y, step, rnd);
-                }
-            }
-            rnd = static_cast<int>(rnd * std::pow(2.0, -roughness));
-        }
-
-        std::vector<char> cmap(mapsz_x * mapsz_y, ' ');
-        for (int y = 1; y < mapsz_y - 1; ++y)
-        {
-            for (int x = 1; x < mapsz_x - 1; ++x)
-            {
-                int avg = Avg4(heightmap, x, y, 1);
-                cmap[XY(x - 1, y - 1)] = 
-                    (avg < deep_water) ? '~' : 
-                    (avg < shallow_water) ? '`' :
-                    (avg < plain) ? ' ' :
-                    (avg < forest) ? '&' :  
-                    '^';
-            }
-        }
-                 
-
-        Map::TerrainMapping tmap;
-        tmap.insert(Map::TerrainMapping::value_type(' ', Map::Grass));
-        tmap.insert(Map::TerrainMapping::value_type('~', Map::DeepWater));
-        tmap.insert(Map::TerrainMapping::value_type('`', Map::ShallowWater));
-        tmap.insert(Map::TerrainMapping::value_type('&', Map::Tree));
-        tmap.insert(Map::TerrainMapping::value_type('^', Map::Mountain));
-
-        MapH tmp(new Map(mapsz_x, mapsz_y, &cmap[0], tmap));
+        // terrain is worked out a chunk at a time when wanted, so none of
+        // it is held until something changes it
+        boost::shared_ptr<Map::TerrainSource const> src(
+            new Heightmap(size_x, size_y, Dice::Random0(std::numeric_limits<int>::max())));
+        MapH tmp(new Map(size_x, size_y, src));
         return tmp;
     }
 
+private:
     /*
      *   A--B--C--D--E       *--B--*--D--*       
      *   |  |  |  |  |       |  |  |  |  |
@@ -127,29 +98,155 @@ public:
      *   U--V--W--X--Y       *--V--*--X--*
      */
 
-    // calculate M using (A + E + U + Y) / 4 + random(-rnd, rnd)
-    // calculate C using (A + E) / 2
-    static void GenMidpoints(Vertices & v, int tlx, int tly, int step, int rnd)
+    /**
+     * Midpoint displacement over a power of two square of vertices big
+     * enough to cover the map, using the top left of it. At each step M is
+     * (A + E + U + Y) / 4 + random(-rnd, rnd) and C is (A + E) / 2, then
+     * the step and rnd shrink. Each square of the map takes the average of
+     * the vertices at its corners.
+     *
+     * The heightmap is never held whole. A chunk works out just the
+     * vertices it needs, coarsest step first, and the random part of each
+     * is a hash of the seed and where it is, so a chunk comes out the same
+     * however often it is generated.
+     */
+    class Heightmap : public Map::TerrainSource
     {
-        // M, C, W, K, O
-        v[XY(tlx + step/2, tly + step/2)] = Avg4(v, tlx, tly, step) + Dice::Random0(2 * rnd) - rnd;
-        v[XY(tlx + step/2, tly)] = (v[XY(tlx, tly)] + v[XY(tlx + step, tly)]) / 2;
-        v[XY(tlx + step/2, tly + step)] = (v[XY(tlx, tly + step)] + v[XY(tlx + step, tly + step)]) / 2;
-        v[XY(tlx, tly + step/2)] = (v[XY(tlx, tly)] + v[XY(tlx, tly + step)]) / 2;
-        v[XY(tlx + step, tly + step/2)] = (v[XY(tlx + step, tly)] + v[XY(tlx + step, tly + step)]) / 2;
-    }
+    public:
+        Heightmap(int size_x, int size_y, unsigned int seed) :
+            m_side(2), m_rnd(), m_seed(seed), m_xsize(size_x), m_ysize(size_y)
+        {
+            while (m_side < size_x || m_side < size_y)
+                m_side *= 2;
+            int rnd = begin_rand;
+            for (int step = m_side; step > 1; step /= 2)
+            {
+                m_rnd.push_back(rnd);
+                rnd = static_cast<int>(rnd * std::pow(2.0, -roughness));
+            }
+        }
 
-    static int XY(int x, int y)
-    {
-        return y * mapsz_x + x;
-    }
+        void generate(int x0, int y0, int w, int h, Map::Terrain *out) const
+        {
+            // the square at (x, y) has the vertex at (x + 1, y + 1) top
+            // left. The last two rows and columns are left as grass
+            int const x1 = std::min(x0 + w, m_xsize - 2);
+            int const y1 = std::min(y0 + h, m_ysize - 2);
+            Vertices v;
+            if (x1 > x0 && y1 > y0)
+                heights(x0 + 1, y0 + 1, x1 + 1, y1 + 1, v);
+
+            int const across = x1 - x0 + 1;
+            for (int y = 0; y < h; ++y)
+            {
+                for (int x = 0; x < w; ++x)
+                {
+                    Map::Terrain t = Map::Grass;
+                    if (x0 + x < x1 && y0 + y < y1)
+                    {
+                        int const i = y * across + x;
+                        t = Classify((v[i] + v[i + 1] + v[i + across] + v[i + across + 1]) / 4);
+                    }
+                    out[y * Side + x] = t;
+                }
+            }
+        }
 
-    static int Avg4(Vertices & v, int tlx, int tly, int step)
-    {
-        return (v[XY(tlx, tly)] + v[XY(tlx + step, tly)] + 
-                v[XY(tlx, tly + step)] + v[XY(tlx + step, tly + step)]) / 4;
-    }
+    private:
+        enum { Side = ChunkedGrid<Map::Terrain>::ChunkSide };
+
+        // the vertices from (ax, ay) to (bx, by) inclusive, row by row.
+        // Each step works out every vertex on its half step lattice around
+        // the rectangle from the corners of its squares, which the step
+        // before worked out
+        void heights(int ax, int ay, int bx, int by, Vertices & out) const
+        {
+            Vertices v(4, 0);
+            Vertices next;
+            int lx = 0;
+            int ly = 0;
+            int across = 2;
+            int level = 0;
+            for (int step = m_side; step > 1; step /= 2, ++level)
+            {
+                int const half = step / 2;
+                int const nlx = ax / half * half;
+                int const nly = ay / half * half;
+                int const nacross = (std::min(m_side, (bx + half - 1) / half * half) - nlx) / half + 1;
+                int const ndown = (std::min(m_side, (by + half - 1) / half * half) - nly) / half + 1;
+                next.resize(nacross * ndown);
+
+                for (int j = 0; j < ndown; ++j)
+                {
+                    for (int i = 0; i < nacross; ++i)
+                    {
+                        int const x = nlx + i * half;
+                        int const y = nly + j * half;
+                        bool const midx = x % step != 0;
+                        bool const midy = y % step != 0;
+                        int value;
+                        if (midx && midy)
+                            value = (At(v, lx, ly, across, step, x - half, y - half) +
+                                     At(v, lx, ly, across, step, x + half, y - half) +
+                                     At(v, lx, ly, across, step, x - half, y + half) +
+                                     At(v, lx, ly, across, step, x + half, y + half)) / 4 +
+                                    displace(x, y, m_rnd[level]);
+                        else if (midx)
+                            value = (At(v, lx, ly, across, step, x - half, y) +
+                                     At(v, lx, ly, across, step, x + half, y)) / 2;
+                        else if (midy)
+                            value = (At(v, lx, ly, across, step, x, y - half) +
+                                     At(v, lx, ly, across, step, x, y + half)) / 2;
+                        else
+                            value = At(v, lx, ly, across, step, x, y);
+                        next[j * nacross + i] = static_cast<short>(value);
+                    }
+                }
+
+                v.swap(next);
+                lx = nlx;
+                ly = nly;
+                across = nacross;
+            }
+            out.swap(v);
+        }
+
+        // the random part of a vertex, from -rnd to rnd - 1
+        int displace(int x, int y, int rnd) const
+        {
+            if (rnd <= 0)
+                return 0;
+            unsigned int h = m_seed ^ (static_cast<unsigned int>(x) * 0x9e3779b1U) ^
+                             (static_cast<unsigned int>(y) * 0x85ebca6bU);
+            h ^= h >> 16;
+            h *= 0x7feb352dU;
+            h ^= h >> 15;
+            h *= 0x846ca68bU;
+            h ^= h >> 16;
+            return static_cast<int>(h % (2 * rnd)) - rnd;
+        }
+
+        // vertex (x, y) of a lattice step apart with (lx, ly) top left
+        static int At(Vertices const & v, int lx, int ly, int across, int step, int x, int y)
+        {
+            return v[(y - ly) / step * across + (x - lx) / step];
+        }
+
+        static Map::Terrain Classify(int height)
+        {
+            return (height < deep_water) ? Map::DeepWater :
+                   (height < shallow_water) ? Map::ShallowWater :
+                   (height < plain) ? Map::Grass :
+                   (height < forest) ? Map::Tree :
+                   Map::Mountain;
+        }
 
+        int m_side;
+        std::vector<int> m_rnd;
+        unsigned int m_seed;
+        int m_xsize;
+        int m_ysize;
+    };
 };
 
 
@@ -0,0 +1,253 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#include "pathfind.h"
+
+//============================================================================
+// PathFinder
+//============================================================================
+int const PathFinder::Offsets[8][2] =
+{
+    {-1, -1}, {0, -1}, {1, -1},
+    {-1,  0},          {1,  0},
+    {-1,  1}, {0,  1}, {1,  1}
+};
+
+
+PathFinder::PathFinder(int x, int y) :
+    m_squares(x * y),
+    m_heap(),
+    m_generation(0),
+    m_expanded(0),
+    m_xsize(x),
+    m_ysize(y)
+{
+    Square blank = { 0, 0, -1, Unseen };
+    std::fill(m_squares.begin(), m_squares.end(), blank);
+    m_heap.reserve(x + y);
+}
+
+
+void
+PathFinder::beginSearch()
+{
+    m_heap.clear();
+    m_expanded = 0;
+
+    // on wrap-around old stamps could match again, so really clear them once
+    if (++m_generation == 0)
+    {
+        for (Squares::iterator it = m_squares.begin(); it != m_squares.end(); ++it)
+            it->gen = 0;
+        m_generation = 1;
+    }
+}
+
+
+void
+PathFinder::buildPath(int index, std::vector<Point> & path) const
+{
+    // the start square has no parent and is not part of the path
+    int len = 0;
+    for (int i = index; m_squares[i].parent != -1; i = m_squares[i].parent)
+        ++len;
+
+    path.resize(len);
+    for (int i = index; m_squares[i].parent != -1; i = m_squares[i].parent)
+        path[--len] = Point(i % m_xsize, i / m_xsize);
+}
+
+
+// jump points are joined by straight or diagonal lines, so fill them in
+void
+PathFinder::buildJumpPath(int index, std::vector<Point> & path) const
+{
+    int len = 0;
+    for (int i = index; m_squares[i].parent != -1; i = m_squares[i].parent)
+        len += m_squares[i].cost - m_squares[m_squares[i].parent].cost;
+
+    path.resize(len);
+    for (int i = index; m_squares[i].parent != -1; i = m_squares[i].parent)
+    {
+        int x = i % m_xsize;
+        int y = i / m_xsize;
+        int const fx = m_squares[i].parent % m_xsize;
+        int const fy = m_squares[i].parent / m_xsize;
+        int const dx = x > fx ? 1 : x < fx ? -1 : 0;
+        int const dy = y > fy ? 1 : y < fy ? -1 : 0;
+        for ( ; x != fx || y != fy; x -= dx, y -= dy)
+            path[--len] = Point(x, y);
+    }
+}
+
+
+
+//============================================================================
+// DistanceField
+//============================================================================
+DistanceField::DistanceField(int x, int y) :
+    m_gen(x * y, 0U),
+    m_dist(x * y, 0),
+    m_queue(),
+    m_generation(0),
+    m_target(),
+    m_xsize(x),
+    m_ysize(y)
+{
+    m_queue.reserve(x * y);
+}
+
+
+
+//============================================================================
+// IncrementalPath
+//============================================================================
+// D* Lite, from Koenig & Likhachev, "D* Lite" (AAAI 2002), figure 3
+IncrementalPath::IncrementalPath() :
+    m_nodes(),
+    m_heap(),
+    m_path(),
+    m_owner(0),
+    m_width(0),
+    m_start(-1),
+    m_last(-1),
+    m_goal(-1),
+    m_km(0),
+    m_expanded(0),
+    m_stamp(0),
+    m_destination(-1, -1),
+    m_waypoints(),
+    m_next_waypoint(0)
+{
+}
+
+
+void
+IncrementalPath::reset(MapId owner, int width, Point s, Point goal)
+{
+    m_nodes.clear();
+    m_heap.clear();
+    m_path.clear();
+    m_owner = owner;
+    m_width = width;
+    m_start = m_last = s.Y() * width + s.X();
+    m_goal = goal.Y() * width + goal.X();
+    m_destination = goal;
+    m_km = 0;
+    m_expanded = 0;
+
+    Node & node = m_nodes[m_goal];
+    node.rhs = 0;
+    node.queued = true;
+    node.key = calculateKey(m_goal, node);
+    HeapEntry ent = { node.key, m_goal };
+    m_heap.push_back(ent);
+}
+
+
+bool
+IncrementalPath::isPlanning(MapId owner, Point goal) const
+{
+    return owner == m_owner && m_owner && goal.Y() * m_width + goal.X() == m_goal;
+}
+
+
+Point
+IncrementalPath::getGoal() const
+{
+    return m_width ? Point(m_goal % m_width, m_goal / m_width) : Point(-1, -1);
+}
+
+
+void
+IncrementalPath::setWaypoints(std::vector<Point> const & waypoints)
+{
+    m_waypoints = waypoints;
+    m_next_waypoint = 0;
+}
+
+
+bool
+IncrementalPath::nextWaypoint(Point & waypoint)
+{
+    if (m_next_waypoint >= m_waypoints.size())
+        return false;
+    waypoint = m_waypoints[m_next_waypoint++];
+    return true;
+}
+
+
+void
+IncrementalPath::moveStart(Point s)
+{
+    int const start = s.Y() * m_width + s.X();
+    if (start == m_start)
+        return;
+    m_start = start;
+    m_km += heuristic(m_last);
+    m_last = m_start;
+}
+
+
+bool
+IncrementalPath::nextStep(Point & step) const
+{
+    if (m_path.empty())
+        return false;
+    step = m_path.front();
+    return true;
+}
+
+
+int
+IncrementalPath::g(int index) const
+{
+    Nodes::const_iterator it = m_nodes.find(index);
+    return it == m_nodes.end() ? int(Infinity) : it->second.g;
+}
+
+
+int
+IncrementalPath::rhs(int index) const
+{
+    Nodes::const_iterator it = m_nodes.find(index);
+    return it == m_nodes.end() ? int(Infinity) : it->second.rhs;
+}
+
+
+int
+IncrementalPath::heuristic(int index) const
+{
+    return PathFinder::Heuristic(index % m_width, index / m_width,
+                                 m_start % m_width, m_start / m_width);
+}
+
+
+IncrementalPath::Key
+IncrementalPath::calculateKey(int index, Node const & node) const
+{
+    int const m = std::min(node.g, node.rhs);
+    Key key = { m >= Infinity ? int(Infinity) : m + heuristic(index) + m_km, m };
+    return key;
+}
+
+
+// discards stale heap entries until the top is a live one
+bool
+IncrementalPath::topKey(Key & key)
+{
+    while (!m_heap.empty())
+    {
+        HeapEntry const & top = m_heap.front();
+        Nodes::const_iterator it = m_nodes.find(top.index);
+        if (it != m_nodes.end() && it->second.queued && it->second.key == top.key)
+        {
+            key = top.key;
+            return true;
+        }
+        std::pop_heap(m_heap.begin(), m_heap.end(), HeapComp());
+        m_heap.pop_back();
+    }
+    return false;
+}
@@ -0,0 +1,880 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#ifndef H_PATHFIND_
+#define H_PATHFIND_ 1
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <vector>
+
+#include "boost/noncopyable.hpp"
+#include "boost/unordered_map.hpp"
+
+#include "handles.h"
+
+
+/**
+ * PathFinder is an A* engine over a fixed size grid of 8-connected squares
+ * with a uniform step cost of 1. All scratch state lives in flat arrays
+ * which are kept between searches. Rather than clearing the arrays, each
+ * search bumps a generation counter and a square is only valid if its stamp
+ * matches, so a search performs no heap allocation once the open list has
+ * grown to its working size.
+ *
+ * Passability is supplied per search as a functor bool(int x, int y) which
+ * must return false for anything outside the grid.
+ */
+class PathFinder : private boost::noncopyable
+{
+public:
+    /**
+     * Create an engine for a grid
+     *
+     * @param x      width of grid
+     * @param y      height of grid
+     */
+    PathFinder(int x, int y);
+
+    /**
+     * Find a path from s to e. As with Map::pathFind, the start is not
+     * included in the path and the end need not be passable (it is usually
+     * occupied by the target).
+     *
+     * @param pass   passability functor bool(int x, int y)
+     * @param s      beginning
+     * @param e      end position
+     * @param path   cleared, then filled with coordinates to follow
+     * @return       true if a path was found
+     */
+    template<typename Passable>
+    bool findPath(Passable const & pass, Point s, Point e, std::vector<Point> & path);
+
+    /**
+     * Find a path from s to e with Jump Point Search. Runs of open squares
+     * are skipped over in straight and diagonal lines, and only squares where
+     * the route may have to turn are put on the open list. The path has the
+     * same length as findPath() would give, though it may take another of
+     * the equally short routes.
+     *
+     * @param pass   passability functor bool(int x, int y)
+     * @param s      beginning
+     * @param e      end position
+     * @param path   cleared, then filled with coordinates to follow
+     * @return       true if a path was found
+     */
+    template<typename Passable>
+    bool findJumpPath(Passable const & pass, Point s, Point e, std::vector<Point> & path);
+
+    /**
+     * Number of squares expanded by the last search
+     *
+     * @return       expanded squares
+     */
+    int getExpanded() const { return m_expanded; }
+
+    /**
+     * Width and height of the grid the engine was created for
+     *
+     * @return       coords representing size
+     */
+    Point getSize() const { return Point(m_xsize, m_ysize); }
+
+    /**
+     * Chebyshev distance, admissible for 8-connected unit-cost grids
+     */
+    static int Heuristic(int x1, int y1, int x2, int y2)
+    {
+        return std::max(std::abs(x1 - x2), std::abs(y1 - y2));
+    }
+
+    /**
+     * Column and row offsets of the 8 neighbouring squares
+     */
+    static int const Offsets[8][2];
+
+private:
+    enum State
+    {
+        Unseen, Open, Closed
+    };
+
+    struct Square
+    {
+        unsigned int  gen;       // generation this square was last touched
+        int           cost;      // cost to get here
+        int           parent;    // index of parent square, -1 for start
+        unsigned char state;     // State
+    };
+
+    struct HeapEntry
+    {
+        int total;               // cost to get here plus estimate to target
+        int cost;                // cost to get here (for stale detection)
+        int index;               // square index
+    };
+
+    // min-heap on total, ties broken in favour of squares closer to target
+    struct HeapComp
+    {
+        bool operator()(HeapEntry const & l, HeapEntry const & r) const
+        {
+            return l.total > r.total || (l.total == r.total && l.cost < r.cost);
+        }
+    };
+
+    typedef std::vector<Square>    Squares;
+    typedef std::vector<HeapEntry> Heap;
+
+    void beginSearch();
+    Square & touch(int index);
+    void push(int index, int cost, int total);
+    void buildPath(int index, std::vector<Point> & path) const;
+    void buildJumpPath(int index, std::vector<Point> & path) const;
+
+    template<typename Passable>
+    int jump(Passable const & pass, int x, int y, int dx, int dy, int ex, int ey) const;
+
+    // the target counts as open, so that squares beside it are pruned
+    // exactly as though it were (findPath() reaches it even when it isn't)
+    template<typename Passable>
+    struct WithTarget
+    {
+        WithTarget(Passable const & p, int x, int y) : pass(p), ex(x), ey(y) {}
+        bool operator()(int x, int y) const { return (x == ex && y == ey) || pass(x, y); }
+        Passable const & pass;
+        int ex;
+        int ey;
+    };
+
+    Squares         m_squares;
+    Heap            m_heap;
+    unsigned int    m_generation;
+    int             m_expanded;
+    int             m_xsize;
+    int             m_ysize;
+};
+
+
+inline PathFinder::Square &
+PathFinder::touch(int index)
+{
+    Square & sq = m_squares[index];
+    if (sq.gen != m_generation)
+    {
+        sq.gen = m_generation;
+        sq.state = Unseen;
+    }
+    return sq;
+}
+
+
+inline void
+PathFinder::push(int index, int cost, int total)
+{
+    HeapEntry ent = { total, cost, index };
+    m_heap.push_back(ent);
+    std::push_heap(m_heap.begin(), m_heap.end(), HeapComp());
+}
+
+
+// Good description of A-Star from http://www.policyalmanac.org/games/aStarTutorial.htm
+template<typename Passable>
+bool
+PathFinder::findPath(Passable const & pass, Point s, Point e, std::vector<Point> & path)
+{
+    assert(s.X() >= 0 && s.Y() >= 0 && s.X() < m_xsize && s.Y() < m_ysize);
+    path.clear();
+    if (s.X() == e.X() && s.Y() == e.Y())
+        return false;
+
+    beginSearch();
+    int const ex = e.X();
+    int const ey = e.Y();
+    int const start = s.Y() * m_xsize + s.X();
+    Square & first = touch(start);
+    first.cost = 0;
+    first.parent = -1;
+    first.state = Open;
+    push(start, 0, Heuristic(s.X(), s.Y(), ex, ey));
+
+    while (!m_heap.empty())
+    {
+        // Get the lowest total cost square on open list and put it on the closed list
+        HeapEntry const top = m_heap.front();
+        std::pop_heap(m_heap.begin(), m_heap.end(), HeapComp());
+        m_heap.pop_back();
+
+        Square & parent = m_squares[top.index];
+        if (parent.state == Closed || parent.cost != top.cost)
+            continue;
+        parent.state = Closed;
+        ++m_expanded;
+
+        int const px = top.index % m_xsize;
+        int const py = top.index / m_xsize;
+        int const cost = top.cost + 1;
+
+        // for each of the 8 squares adjacent
+        for (int sq = 0; sq < 8; ++sq)
+        {
+            int const x = px + Offsets[sq][0];
+            int const y = py + Offsets[sq][1];
+
+            // is this the target?
+            if (x == ex && y == ey)
+            {
+                buildPath(top.index, path);
+                path.push_back(Point(x, y));
+                return true;
+            }
+
+            // if it is not walkable, ignore it
+            if (!pass(x, y)) continue;
+
+            // ignore it if closed, or already open with a cheaper cost
+            int const index = y * m_xsize + x;
+            Square & node = touch(index);
+            if (node.state == Closed || (node.state == Open && node.cost <= cost))
+                continue;
+
+            node.cost = cost;
+            node.parent = top.index;
+            node.state = Open;
+            push(index, cost, cost + Heuristic(x, y, ex, ey));
+        }
+    }
+
+    // we've exhausted all nodes, there mustn't be a path to the target
+    return false;
+}
+
+
+// Online Graph Pruning for Pathfinding on Grid Maps, Harabor & Grastien,
+// AAAI 2011. Steps run from (x, y) in direction (dx, dy) and the first
+// square which is the target, or has a neighbour that can only be reached
+// optimally through it, is returned. -1 if a wall is hit first
+template<typename Passable>
+int
+PathFinder::jump(Passable const & pass, int x, int y, int dx, int dy, int ex, int ey) const
+{
+    for (;;)
+    {
+        x += dx;
+        y += dy;
+        if (x == ex && y == ey)
+            return y * m_xsize + x;
+        if (!pass(x, y))
+            return -1;
+
+        if (dx && dy)
+        {
+            if ((!pass(x - dx, y) && pass(x - dx, y + dy)) ||
+                (!pass(x, y - dy) && pass(x + dx, y - dy)))
+                return y * m_xsize + x;
+
+            // a diagonal stops wherever either of its straight parts would
+            if (jump(pass, x, y, dx, 0, ex, ey) != -1 || jump(pass, x, y, 0, dy, ex, ey) != -1)
+                return y * m_xsize + x;
+        }
+        else if (dx)
+        {
+            if ((!pass(x, y + 1) && pass(x + dx, y + 1)) ||
+                (!pass(x, y - 1) && pass(x + dx, y - 1)))
+                return y * m_xsize + x;
+        }
+        else
+        {
+            if ((!pass(x + 1, y) && pass(x + 1, y + dy)) ||
+                (!pass(x - 1, y) && pass(x - 1, y + dy)))
+                return y * m_xsize + x;
+        }
+    }
+}
+
+
+template<typename Passable>
+bool
+PathFinder::findJumpPath(Passable const & open, Point s, Point e, std::vector<Point> & path)
+{
+    assert(s.X() >= 0 && s.Y() >= 0 && s.X() < m_xsize && s.Y() < m_ysize);
+    assert(e.X() >= 0 && e.Y() >= 0 && e.X() < m_xsize && e.Y() < m_ysize);
+    path.clear();
+    if (s.X() == e.X() && s.Y() == e.Y())
+        return false;
+
+    beginSearch();
+    int const ex = e.X();
+    int const ey = e.Y();
+    WithTarget<Passable> const pass(open, ex, ey);
+    int const start = s.Y() * m_xsize + s.X();
+    Square & first = touch(start);
+    first.cost = 0;
+    first.parent = -1;
+    first.state = Open;
+    push(start, 0, Heuristic(s.X(), s.Y(), ex, ey));
+
+    while (!m_heap.empty())
+    {
+        HeapEntry const top = m_heap.front();
+        std::pop_heap(m_heap.begin(), m_heap.end(), HeapComp());
+        m_heap.pop_back();
+
+        Square & parent = m_squares[top.index];
+        if (parent.state == Closed || parent.cost != top.cost)
+            continue;
+        parent.state = Closed;
+        ++m_expanded;
+
+        int const px = top.index % m_xsize;
+        int const py = top.index / m_xsize;
+        if (px == ex && py == ey)
+        {
+            buildJumpPath(top.index, path);
+            return true;
+        }
+
+        // the start looks every way. Any other square only looks onward
+        // from the direction it was reached in, plus its forced neighbours
+        int dirs[8][2];
+        int ndirs = 0;
+        if (parent.parent == -1)
+        {
+            for (int sq = 0; sq < 8; ++sq)
+            {
+                dirs[ndirs][0] = Offsets[sq][0];
+                dirs[ndirs++][1] = Offsets[sq][1];
+            }
+        }
+        else
+        {
+            int const fx = parent.parent % m_xsize;
+            int const fy = parent.parent / m_xsize;
+            int const dx = px > fx ? 1 : px < fx ? -1 : 0;
+            int const dy = py > fy ? 1 : py < fy ? -1 : 0;
+            dirs[ndirs][0] = dx;
+            dirs[ndirs++][1] = dy;
+            if (dx && dy)
+            {
+                dirs[ndirs][0] = dx;
+                dirs[ndirs++][1] = 0;
+                dirs[ndirs][0] = 0;
+                dirs[ndirs++][1] = dy;
+                if (!pass(px - dx, py))
+                {
+                    dirs[ndirs][0] = -dx;
+                    dirs[ndirs++][1] = dy;
+                }
+                if (!pass(px, py - dy))
+                {
+                    dirs[ndirs][0] = dx;
+                    dirs[ndirs++][1] = -dy;
+                }
+            }
+            else if (dx)
+            {
+                for (int side = -1; side <= 1; side += 2)
+                    if (!pass(px, py + side))
+                    {
+                        dirs[ndirs][0] = dx;
+                        dirs[ndirs++][1] = side;
+                    }
+            }
+            else
+            {
+                for (int side = -1; side <= 1; side += 2)
+                    if (!pass(px + side, py))
+                    {
+                        dirs[ndirs][0] = side;
+                        dirs[ndirs++][1] = dy;
+                    }
+            }
+        }
+
+        for (int d = 0; d < ndirs; ++d)
+        {
+            int const index = jump(pass, px, py, dirs[d][0], dirs[d][1], ex, ey);
+            if (index == -1)
+                continue;
+
+            int const x = index % m_xsize;
+            int const y = index / m_xsize;
+            int const cost = top.cost + Heuristic(px, py, x, y);
+            Square & node = touch(index);
+            if (node.state == Closed || (node.state == Open && node.cost <= cost))
+                continue;
+
+            node.cost = cost;
+            node.parent = top.index;
+            node.state = Open;
+            push(index, cost, cost + Heuristic(x, y, ex, ey));
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * DistanceField holds the number of steps from every reachable square to a
+ * single target (a Dijkstra or "flow" map; with unit step costs this is a
+ * breadth first flood). It is built once per target position and then any
+ * number of creatures can walk toward the target by stepping to their
+ * lowest neighbour, which costs a handful of array reads per step.
+ * Like PathFinder, the arrays are generation stamped and reused.
+ */
+class DistanceField : private boost::noncopyable
+{
+public:
+    /**
+     * Create an empty field for a grid
+     *
+     * @param x      width of grid
+     * @param y      height of grid
+     */
+    DistanceField(int x, int y);
+
+    /**
+     * Flood the field outward from target
+     *
+     * @param pass    passability functor bool(int x, int y)
+     * @param target  square every step leads toward
+     * @param maxdist squares further than this are left unreached
+     */
+    template<typename Passable>
+    void compute(Passable const & pass, Point target, int maxdist);
+
+    /**
+     * Steps from square to the target
+     *
+     * @param x      column
+     * @param y      row
+     * @return       number of steps, or -1 if unreached
+     */
+    int getDistance(int x, int y) const
+    {
+        if (x < 0 || y < 0 || x >= m_xsize || y >= m_ysize)
+            return -1;
+        int const i = y * m_xsize + x;
+        return m_gen[i] == m_generation ? m_dist[i] : -1;
+    }
+
+    /**
+     * Choose the neighbouring square which is closest to the target and
+     * currently open. Only squares strictly nearer the target are considered,
+     * so following the field can never loop.
+     *
+     * @param open   functor bool(int x, int y) for squares free to step on
+     * @param from   current square
+     * @param step   set to the square to step to
+     * @return       true if there is a free square downhill
+     */
+    template<typename Open>
+    bool stepDownhill(Open const & open, Point from, Point & step) const;
+
+    /**
+     * Target of the last compute()
+     *
+     * @return       target square
+     */
+    Point getTarget() const { return m_target; }
+
+private:
+    std::vector<unsigned int> m_gen;
+    std::vector<int>          m_dist;
+    std::vector<int>          m_queue;
+    unsigned int              m_generation;
+    Point                     m_target;
+    int                       m_xsize;
+    int                       m_ysize;
+};
+
+
+template<typename Passable>
+void
+DistanceField::compute(Passable const & pass, Point target, int maxdist)
+{
+    if (++m_generation == 0)
+    {
+        std::fill(m_gen.begin(), m_gen.end(), 0U);
+        m_generation = 1;
+    }
+    m_target = target;
+    m_queue.clear();
+
+    int const start = target.Y() * m_xsize + target.X();
+    m_gen[start] = m_generation;
+    m_dist[start] = 0;
+    m_queue.push_back(start);
+
+    for (std::size_t head = 0; head < m_queue.size(); ++head)
+    {
+        int const index = m_queue[head];
+        int const dist = m_dist[index] + 1;
+        if (dist > maxdist)
+            break;
+        int const px = index % m_xsize;
+        int const py = index / m_xsize;
+
+        for (int sq = 0; sq < 8; ++sq)
+        {
+            int const x = px + PathFinder::Offsets[sq][0];
+            int const y = py + PathFinder::Offsets[sq][1];
+            if (!pass(x, y))
+                continue;
+            int const next = y * m_xsize + x;
+            if (m_gen[next] == m_generation)
+                continue;
+            m_gen[next] = m_generation;
+            m_dist[next] = dist;
+            m_queue.push_back(next);
+        }
+    }
+}
+
+
+template<typename Open>
+bool
+DistanceField::stepDownhill(Open const & open, Point from, Point & step) const
+{
+    int best = getDistance(from.X(), from.Y());
+    bool found = false;
+    for (int sq = 0; sq < 8; ++sq)
+    {
+        int const x = from.X() + PathFinder::Offsets[sq][0];
+        int const y = from.Y() + PathFinder::Offsets[sq][1];
+        int const dist = getDistance(x, y);
+        if (dist >= 0 && dist < best && open(x, y))
+        {
+            best = dist;
+            step = Point(x, y);
+            found = true;
+        }
+    }
+    return found;
+}
+
+
+
+/**
+ * IncrementalPath is a D* Lite planner which a creature keeps between turns
+ * to follow a route to a fixed goal. The search runs backward from the goal,
+ * so when the creature moves only the heuristic offset changes, and when
+ * squares along the route change only the costs around them are repaired
+ * instead of searching again from scratch.
+ *
+ * State is held sparsely (only squares the search has touched) as there is
+ * one planner per creature. Squares are traversable as reported by an open
+ * functor bool(int x, int y); the goal is always treated as traversable.
+ */
+class IncrementalPath : private boost::noncopyable
+{
+public:
+    IncrementalPath();
+
+    /**
+     * Forget all search state and plan toward a new goal
+     *
+     * @param owner  identity of the Map being searched
+     * @param width  width of the grid
+     * @param s      current position
+     * @param goal   goal square
+     */
+    void reset(MapId owner, int width, Point s, Point goal);
+
+    /**
+     * Is the planner searching this grid for this goal?
+     *
+     * @param owner  identity of the grid
+     * @param goal   goal square
+     * @return       true if planning can continue incrementally
+     */
+    bool isPlanning(MapId owner, Point goal) const;
+
+    /**
+     * Goal square of the current plan
+     *
+     * @return       goal, or (-1, -1) before the first reset()
+     */
+    Point getGoal() const;
+
+    /**
+     * Note that the creature has moved
+     *
+     * @param s      new position
+     */
+    void moveStart(Point s);
+
+    /**
+     * Note that a square's traversability may have changed
+     *
+     * @param open   open functor
+     * @param c      changed square
+     */
+    template<typename Open>
+    void squareChanged(Open const & open, Point c);
+
+    /**
+     * Bring the plan up to date and cache the route from the current position
+     *
+     * @param open   open functor
+     * @return       true if the goal is reachable
+     */
+    template<typename Open>
+    bool computePath(Open const & open);
+
+    /**
+     * Squares of the cached route, excluding the current position
+     *
+     * @return       route to goal
+     */
+    std::vector<Point> const & getPath() const { return m_path; }
+
+    /**
+     * First square of the cached route
+     *
+     * @param step   set to next square
+     * @return       false if there is no route
+     */
+    bool nextStep(Point & step) const;
+
+    /**
+     * Map change stamp up to which the route has been checked
+     */
+    unsigned int getStamp() const { return m_stamp; }
+    void setStamp(unsigned int stamp) { m_stamp = stamp; }
+
+    /**
+     * Far square the goal is a stop on the way to, or the goal itself
+     */
+    Point getDestination() const { return m_destination; }
+    void setDestination(Point dest) { m_destination = dest; }
+
+    /**
+     * Keep the stops of a far route toward the destination, so each can
+     * become the goal in turn without searching for the route again
+     *
+     * @param waypoints  stops in order, ending with the destination
+     */
+    void setWaypoints(std::vector<Point> const & waypoints);
+
+    /**
+     * Take the next stop kept by setWaypoints()
+     *
+     * @param waypoint   set to the stop
+     * @return           false if there are none left
+     */
+    bool nextWaypoint(Point & waypoint);
+
+    /**
+     * Number of squares expanded since the last reset()
+     *
+     * @return       expanded squares
+     */
+    int getExpanded() const { return m_expanded; }
+
+private:
+    static int const Infinity = 0x3FFFFFFF;
+
+    struct Key
+    {
+        int k1;
+        int k2;
+        bool operator<(Key const & r) const { return k1 < r.k1 || (k1 == r.k1 && k2 < r.k2); }
+        bool operator==(Key const & r) const { return k1 == r.k1 && k2 == r.k2; }
+    };
+
+    struct Node
+    {
+        Node() : g(Infinity), rhs(Infinity), key(), queued(false) {}
+        int  g;
+        int  rhs;
+        Key  key;
+        bool queued;
+    };
+
+    struct HeapEntry
+    {
+        Key key;
+        int index;
+    };
+
+    struct HeapComp
+    {
+        bool operator()(HeapEntry const & l, HeapEntry const & r) const { return r.key < l.key; }
+    };
+
+    typedef boost::unordered_map<int, Node> Nodes;
+    typedef std::vector<HeapEntry>          Heap;
+
+    int g(int index) const;
+    int rhs(int index) const;
+    Key calculateKey(int index, Node const & node) const;
+    bool topKey(Key & key);
+    int heuristic(int index) const;
+    template<typename Open> bool traversable(Open const & open, int x, int y) const;
+    template<typename Open> int bestSuccessor(Open const & open, int index, int & cost) const;
+    template<typename Open> void updateVertex(Open const & open, int index);
+
+    Nodes               m_nodes;
+    Heap                m_heap;
+    std::vector<Point>  m_path;
+    MapId               m_owner;
+    int                 m_width;
+    int                 m_start;
+    int                 m_last;
+    int                 m_goal;
+    int                 m_km;
+    int                 m_expanded;
+    unsigned int        m_stamp;
+    Point               m_destination;
+    std::vector<Point>  m_waypoints;
+    std::size_t         m_next_waypoint;
+};
+
+
+template<typename Open>
+inline bool
+IncrementalPath::traversable(Open const & open, int x, int y) const
+{
+    return (y * m_width + x == m_goal && x >= 0 && x < m_width) || open(x, y);
+}
+
+
+// lowest cost neighbour to continue from index toward the goal
+template<typename Open>
+int
+IncrementalPath::bestSuccessor(Open const & open, int index, int & cost) const
+{
+    int const px = index % m_width;
+    int const py = index / m_width;
+    int best = -1;
+    cost = Infinity;
+    if (!traversable(open, px, py))
+        return best;
+
+    for (int sq = 0; sq < 8; ++sq)
+    {
+        int const x = px + PathFinder::Offsets[sq][0];
+        int const y = py + PathFinder::Offsets[sq][1];
+        if (x < 0 || x >= m_width || !traversable(open, x, y))
+            continue;
+        int const next = y * m_width + x;
+        int const c = g(next);
+        if (c < Infinity && c + 1 < cost)
+        {
+            cost = c + 1;
+            best = next;
+        }
+    }
+    return best;
+}
+
+
+template<typename Open>
+void
+IncrementalPath::updateVertex(Open const & open, int index)
+{
+    Nodes::iterator it = m_nodes.find(index);
+    if (it == m_nodes.end())
+        it = m_nodes.insert(Nodes::value_type(index, Node())).first;
+    Node & node = it->second;
+
+    if (index != m_goal)
+        bestSuccessor(open, index, node.rhs);
+
+    // stale heap entries are skipped when popped, so just mark and push
+    node.queued = node.g != node.rhs;
+    if (node.queued)
+    {
+        node.key = calculateKey(index, node);
+        HeapEntry ent = { node.key, index };
+        m_heap.push_back(ent);
+        std::push_heap(m_heap.begin(), m_heap.end(), HeapComp());
+    }
+}
+
+
+template<typename Open>
+void
+IncrementalPath::squareChanged(Open const & open, Point c)
+{
+    // the square's own cost, and that of every edge into it, may have changed
+    updateVertex(open, c.Y() * m_width + c.X());
+    for (int sq = 0; sq < 8; ++sq)
+    {
+        int const x = c.X() + PathFinder::Offsets[sq][0];
+        int const y = c.Y() + PathFinder::Offsets[sq][1];
+        if (x >= 0 && x < m_width && y >= 0 && m_nodes.count(y * m_width + x))
+            updateVertex(open, y * m_width + x);
+    }
+}
+
+
+template<typename Open>
+bool
+IncrementalPath::computePath(Open const & open)
+{
+    Key top;
+    for (;;)
+    {
+        Nodes::iterator st = m_nodes.find(m_start);
+        Node start_node = st == m_nodes.end() ? Node() : st->second;
+        if (!topKey(top) ||
+            (!(top < calculateKey(m_start, start_node)) && start_node.rhs == start_node.g))
+            break;
+
+        HeapEntry const ent = m_heap.front();
+        std::pop_heap(m_heap.begin(), m_heap.end(), HeapComp());
+        m_heap.pop_back();
+
+        Node & node = m_nodes[ent.index];
+        Key const knew = calculateKey(ent.index, node);
+        ++m_expanded;
+
+        if (ent.key < knew)
+        {
+            node.key = knew;
+            HeapEntry again = { knew, ent.index };
+            m_heap.push_back(again);
+            std::push_heap(m_heap.begin(), m_heap.end(), HeapComp());
+            continue;
+        }
+
+        node.queued = false;
+        bool const overconsistent = node.g > node.rhs;
+        node.g = overconsistent ? node.rhs : int(Infinity);
+
+        int const px = ent.index % m_width;
+        int const py = ent.index / m_width;
+        for (int sq = 0; sq < 8; ++sq)
+        {
+            int const x = px + PathFinder::Offsets[sq][0];
+            int const y = py + PathFinder::Offsets[sq][1];
+            if (x >= 0 && x < m_width && y >= 0 && traversable(open, x, y))
+                updateVertex(open, y * m_width + x);
+        }
+        if (!overconsistent)
+            updateVertex(open, ent.index);
+    }
+
+    // cache the route by walking downhill through g from the start
+    m_path.clear();
+    int cost = 0;
+    for (int index = m_start; index != m_goal; )
+    {
+        index = bestSuccessor(open, index, cost);
+        if (index < 0 || static_cast<int>(m_path.size()) > static_cast<int>(m_nodes.size()))
+        {
+            m_path.clear();
+            return false;
+        }
+        m_path.push_back(Point(index % m_width, index / m_width));
+    }
+    return true;
+}
+
+
+#endif
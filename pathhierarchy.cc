@@ -0,0 +1,529 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <utility>
+
+#include "pathfind.h"
+#include "pathhierarchy.h"
+
+//============================================================================
+// HierarchicalPath
+//============================================================================
+HierarchicalPath::HierarchicalPath() :
+    m_waypoints(),
+    m_leg(),
+    m_from(),
+    m_next_waypoint(0),
+    m_next_square(0)
+{
+}
+
+
+bool
+HierarchicalPath::empty() const
+{
+    return m_next_square >= m_leg.size() && m_next_waypoint >= m_waypoints.size();
+}
+
+
+
+//============================================================================
+// PathHierarchy
+//============================================================================
+// Near optimal hierarchical pathfinding (HPA*), Botea, Muller & Schaeffer,
+// Journal of Game Development 1(1), 2004
+namespace
+{
+    // runs of open border at least this long get an entrance at each end
+    int const WideEntrance = 6;
+}
+
+
+struct PathHierarchy::ClusterPass
+{
+    ClusterPass(PathHierarchy const & hier, int cluster) :
+        pass(hier.m_passable), x0(0), y0(0), w(0), h(0)
+    {
+        hier.clusterBounds(cluster, x0, y0, w, h);
+    }
+
+    bool operator()(int x, int y) const
+    {
+        return x >= 0 && y >= 0 && x < w && y < h && pass.test(x + x0, y + y0);
+    }
+
+    Bitplane const & pass;
+    int x0;
+    int y0;
+    int w;
+    int h;
+};
+
+
+PathHierarchy::PathHierarchy(int clustersize, Bitplane const & passable) :
+    m_passable(passable),
+    m_east(),
+    m_south(),
+    m_members(),
+    m_dirty(),
+    m_dirtylist(),
+    m_temp(),
+    m_nodes(),
+    m_searched(),
+    m_field(new DistanceField(clustersize, clustersize)),
+    m_local(new PathFinder(clustersize, clustersize)),
+    m_xsize(passable.getWidth()),
+    m_ysize(passable.getHeight()),
+    m_csize(clustersize),
+    m_cwidth((m_xsize + clustersize - 1) / clustersize),
+    m_cheight((m_ysize + clustersize - 1) / clustersize),
+    m_expanded(0)
+{
+    int const clusters = m_cwidth * m_cheight;
+    m_east.resize(clusters);
+    m_south.resize(clusters);
+    m_members.resize(clusters);
+    m_dirty.resize(clusters, 0);
+
+    for (int c = 0; c < clusters; ++c)
+    {
+        buildBorder(c, true);
+        buildBorder(c, false);
+    }
+    for (int c = 0; c < clusters; ++c)
+        buildCluster(c);
+}
+
+
+PathHierarchy::~PathHierarchy()
+{
+}
+
+
+int
+PathHierarchy::clusterOf(int x, int y) const
+{
+    return (y / m_csize) * m_cwidth + x / m_csize;
+}
+
+
+void
+PathHierarchy::clusterBounds(int cluster, int & x0, int & y0, int & w, int & h) const
+{
+    x0 = (cluster % m_cwidth) * m_csize;
+    y0 = (cluster / m_cwidth) * m_csize;
+    w = std::min(m_csize, m_xsize - x0);
+    h = std::min(m_csize, m_ysize - y0);
+}
+
+
+// find the entrances across the east or south edge of a cluster
+void
+PathHierarchy::buildBorder(int cluster, bool east)
+{
+    Transitions & border = east ? m_east[cluster] : m_south[cluster];
+    border.clear();
+    if (east ? cluster % m_cwidth == m_cwidth - 1 : cluster / m_cwidth == m_cheight - 1)
+        return;
+
+    int x0, y0, w, h;
+    clusterBounds(cluster, x0, y0, w, h);
+    int const len = east ? h : w;
+    int const near0 = east ? y0 * m_xsize + x0 + w - 1 : (y0 + h - 1) * m_xsize + x0;
+    int const along = east ? m_xsize : 1;
+    int const across = east ? 1 : m_xsize;
+
+    // a bit for each square along the border open on both sides. The south
+    // border is a pair of rows, so is read a word at a time
+    int const bits = Bitplane::WordBits;
+    std::vector<Bitplane::Word> open((len + bits - 1) / bits, 0);
+    for (int i = 0; i < len; i += bits)
+    {
+        Bitplane::Word word = 0;
+        if (east)
+        {
+            for (int j = 0; j < bits && i + j < len; ++j)
+                if (m_passable.test(x0 + w - 1, y0 + i + j) && m_passable.test(x0 + w, y0 + i + j))
+                    word |= Bitplane::Word(1) << j;
+        }
+        else
+        {
+            word = m_passable.getRow(x0 + i, y0 + h - 1) & m_passable.getRow(x0 + i, y0 + h);
+            if (len - i < bits)
+                word &= (Bitplane::Word(1) << (len - i)) - 1;
+        }
+        open[i / bits] = word;
+    }
+
+    for (int i = 0; i < len; )
+    {
+        int const near = near0 + i * along;
+        if (!((open[i / bits] >> (i % bits)) & 1))
+        {
+            ++i;
+            continue;
+        }
+
+        int run = 1;
+        while (i + run < len && ((open[(i + run) / bits] >> ((i + run) % bits)) & 1))
+            ++run;
+
+        Transition t;
+        if (run >= WideEntrance)
+        {
+            t.near = near;
+            t.far = near + across;
+            border.push_back(t);
+            t.near = near + (run - 1) * along;
+            t.far = t.near + across;
+            border.push_back(t);
+        }
+        else
+        {
+            t.near = near + (run / 2) * along;
+            t.far = t.near + across;
+            border.push_back(t);
+        }
+        i += run;
+    }
+}
+
+
+void
+PathHierarchy::addTransition(int cluster, int square, int other)
+{
+    Node & node = m_nodes[square];
+    if (node.cluster < 0)
+    {
+        node.cluster = cluster;
+        m_members[cluster].push_back(square);
+    }
+    node.edges.push_back(Edge(other, 1));
+}
+
+
+void
+PathHierarchy::buildCluster(int cluster)
+{
+    std::vector<int> & members = m_members[cluster];
+    for (std::vector<int>::iterator it = members.begin(); it != members.end(); ++it)
+        m_nodes.erase(*it);
+    members.clear();
+
+    Transitions::const_iterator it;
+    for (it = m_east[cluster].begin(); it != m_east[cluster].end(); ++it)
+        addTransition(cluster, it->near, it->far);
+    for (it = m_south[cluster].begin(); it != m_south[cluster].end(); ++it)
+        addTransition(cluster, it->near, it->far);
+    if (cluster % m_cwidth > 0)
+        for (it = m_east[cluster - 1].begin(); it != m_east[cluster - 1].end(); ++it)
+            addTransition(cluster, it->far, it->near);
+    if (cluster / m_cwidth > 0)
+        for (it = m_south[cluster - m_cwidth].begin(); it != m_south[cluster - m_cwidth].end(); ++it)
+            addTransition(cluster, it->far, it->near);
+
+    // copy, as linkWithinCluster() doesn't add members but does touch m_nodes
+    std::vector<int> squares(members);
+    for (std::vector<int>::iterator sq = squares.begin(); sq != squares.end(); ++sq)
+        linkWithinCluster(cluster, *sq, true);
+}
+
+
+// flood the cluster from square and join it to every member it reaches.
+// Outward edges belong to square; inward edges are temporary and recorded
+void
+PathHierarchy::linkWithinCluster(int cluster, int square, bool outward)
+{
+    ClusterPass pass(*this, cluster);
+    m_field->compute(pass, Point(square % m_xsize - pass.x0, square / m_xsize - pass.y0), m_csize * m_csize);
+
+    std::vector<int> const & members = m_members[cluster];
+    for (std::vector<int>::const_iterator it = members.begin(); it != members.end(); ++it)
+    {
+        int const dist = m_field->getDistance(*it % m_xsize - pass.x0, *it / m_xsize - pass.y0);
+        if (dist <= 0)
+            continue;
+        if (outward)
+        {
+            m_nodes[square].edges.push_back(Edge(*it, dist));
+        }
+        else
+        {
+            Node & node = m_nodes[*it];
+            m_temp.push_back(std::make_pair(*it, static_cast<int>(node.edges.size())));
+            node.edges.push_back(Edge(square, dist));
+        }
+    }
+}
+
+
+void
+PathHierarchy::setPassable(int x, int y, bool passable)
+{
+    assert(x >= 0 && y >= 0 && x < m_xsize && y < m_ysize);
+    if (m_passable.test(x, y) == passable)
+        return;
+    m_passable.set(x, y, passable);
+
+    int const cluster = clusterOf(x, y);
+    if (!m_dirty[cluster])
+    {
+        m_dirty[cluster] = 1;
+        m_dirtylist.push_back(cluster);
+    }
+}
+
+
+void
+PathHierarchy::rebuildDirty()
+{
+    if (m_dirtylist.empty())
+        return;
+
+    // borders on all four sides may have changed...
+    std::vector<int> rebuild;
+    for (std::vector<int>::iterator it = m_dirtylist.begin(); it != m_dirtylist.end(); ++it)
+    {
+        int const c = *it;
+        buildBorder(c, true);
+        buildBorder(c, false);
+        rebuild.push_back(c);
+        if (c % m_cwidth > 0)
+        {
+            buildBorder(c - 1, true);
+            rebuild.push_back(c - 1);
+        }
+        if (c / m_cwidth > 0)
+        {
+            buildBorder(c - m_cwidth, false);
+            rebuild.push_back(c - m_cwidth);
+        }
+        if (c % m_cwidth < m_cwidth - 1)
+            rebuild.push_back(c + 1);
+        if (c / m_cwidth < m_cheight - 1)
+            rebuild.push_back(c + m_cwidth);
+        m_dirty[c] = 0;
+    }
+    m_dirtylist.clear();
+
+    // ...so every cluster sharing one needs its entrances rebuilt
+    std::sort(rebuild.begin(), rebuild.end());
+    rebuild.erase(std::unique(rebuild.begin(), rebuild.end()), rebuild.end());
+    for (std::vector<int>::iterator it = rebuild.begin(); it != rebuild.end(); ++it)
+        buildCluster(*it);
+}
+
+
+bool
+PathHierarchy::findRoute(Point s, Point e, HierarchicalPath & route)
+{
+    route.m_waypoints.clear();
+    route.m_leg.clear();
+    route.m_from = s;
+    route.m_next_waypoint = 0;
+    route.m_next_square = 0;
+    m_expanded = 0;
+
+    int const start = s.Y() * m_xsize + s.X();
+    int const goal = e.Y() * m_xsize + e.X();
+    if (start == goal)
+        return false;
+    rebuildDirty();
+
+    // splice the start and goal into the graph for the length of the search
+    int const scluster = clusterOf(s.X(), s.Y());
+    int const gcluster = clusterOf(e.X(), e.Y());
+    bool const start_node = m_nodes.count(start) != 0;
+    bool const goal_node = m_nodes.count(goal) != 0;
+    m_temp.clear();
+
+    Node & snode = m_nodes[start];
+    snode.cluster = scluster;
+    m_temp.push_back(std::make_pair(start, static_cast<int>(snode.edges.size())));
+    linkWithinCluster(scluster, start, true);
+    if (scluster == gcluster)
+    {
+        int const dist = m_field->getDistance(e.X() - (scluster % m_cwidth) * m_csize,
+                                              e.Y() - (scluster / m_cwidth) * m_csize);
+        if (dist > 0)
+            m_nodes[start].edges.push_back(Edge(goal, dist));
+    }
+    if (!goal_node)
+    {
+        m_nodes[goal].cluster = gcluster;
+        linkWithinCluster(gcluster, goal, false);
+    }
+
+    // A* over the abstract graph
+    typedef std::pair<int, std::pair<int, int> > Entry;     // total, (-cost, node)
+    std::vector<Entry> heap;
+    m_searched.clear();
+    Search first = { 0, -1, false };
+    m_searched[start] = first;
+    heap.push_back(Entry(PathFinder::Heuristic(s.X(), s.Y(), e.X(), e.Y()), std::make_pair(0, start)));
+    bool found = false;
+
+    while (!heap.empty())
+    {
+        std::pop_heap(heap.begin(), heap.end(), std::greater<Entry>());
+        int const cost = -heap.back().second.first;
+        int const index = heap.back().second.second;
+        heap.pop_back();
+
+        Search & here = m_searched[index];
+        if (here.closed || here.cost != cost)
+            continue;
+        here.closed = true;
+        ++m_expanded;
+        if (index == goal)
+        {
+            found = true;
+            break;
+        }
+
+        std::vector<Edge> const & edges = m_nodes[index].edges;
+        for (std::vector<Edge>::const_iterator it = edges.begin(); it != edges.end(); ++it)
+        {
+            int const ncost = cost + it->cost;
+            Searched::iterator there = m_searched.find(it->to);
+            if (there != m_searched.end() && (there->second.closed || there->second.cost <= ncost))
+                continue;
+            Search next = { ncost, index, false };
+            m_searched[it->to] = next;
+            int const total = ncost + PathFinder::Heuristic(it->to % m_xsize, it->to / m_xsize, e.X(), e.Y());
+            heap.push_back(Entry(total, std::make_pair(-ncost, it->to)));
+            std::push_heap(heap.begin(), heap.end(), std::greater<Entry>());
+        }
+    }
+
+    if (found)
+    {
+        for (int index = goal; index != start; index = m_searched[index].parent)
+            route.m_waypoints.push_back(Point(index % m_xsize, index / m_xsize));
+        std::reverse(route.m_waypoints.begin(), route.m_waypoints.end());
+    }
+
+    // and take them out again, latest first
+    for (std::vector<std::pair<int, int> >::reverse_iterator it = m_temp.rbegin(); it != m_temp.rend(); ++it)
+    {
+        std::vector<Edge> & edges = m_nodes[it->first].edges;
+        edges.erase(edges.begin() + it->second, edges.end());
+    }
+    m_temp.clear();
+    if (!start_node)
+        m_nodes.erase(start);
+    if (!goal_node)
+        m_nodes.erase(goal);
+
+    return found;
+}
+
+
+bool
+PathHierarchy::refineLeg(Point from, Point to, std::vector<Point> & leg)
+{
+    leg.clear();
+    if (PathFinder::Heuristic(from.X(), from.Y(), to.X(), to.Y()) <= 1)
+    {
+        leg.push_back(to);
+        return true;
+    }
+
+    // every longer leg was measured inside a single cluster
+    int const cluster = clusterOf(from.X(), from.Y());
+    if (cluster != clusterOf(to.X(), to.Y()))
+        return false;
+
+    ClusterPass pass(*this, cluster);
+    if (!m_local->findPath(pass, Point(from.X() - pass.x0, from.Y() - pass.y0),
+                           Point(to.X() - pass.x0, to.Y() - pass.y0), leg))
+        return false;
+    for (std::vector<Point>::iterator it = leg.begin(); it != leg.end(); ++it)
+        *it = Point(it->X() + pass.x0, it->Y() + pass.y0);
+    return true;
+}
+
+
+bool
+PathHierarchy::nextStep(HierarchicalPath & route, Point from, Point & step)
+{
+    // a follower off the route (blocked, or moved some other way) takes
+    // up its leg again from where it is
+    if (!(from == route.m_from))
+    {
+        route.m_from = from;
+        if (!route.m_leg.empty())
+        {
+            route.m_leg.clear();
+            route.m_next_square = 0;
+            --route.m_next_waypoint;
+        }
+    }
+
+    while (route.m_next_square >= route.m_leg.size())
+    {
+        if (route.m_next_waypoint >= route.m_waypoints.size())
+            return false;
+        Point const to = route.m_waypoints[route.m_next_waypoint++];
+        if (to == route.m_from)
+            continue;
+        rebuildDirty();
+        if (!refineLeg(route.m_from, to, route.m_leg))
+        {
+            route.m_leg.clear();
+            route.m_waypoints.clear();
+            return false;
+        }
+        route.m_next_square = 0;
+    }
+
+    step = route.m_leg[route.m_next_square++];
+    route.m_from = step;
+    return true;
+}
+
+
+bool
+PathHierarchy::detour(HierarchicalPath & route, Point from, Point & step)
+{
+    assert(route.m_next_square > 0 && route.m_next_waypoint > 0);
+    Point const blocked = step;
+    Point const to = route.m_waypoints[route.m_next_waypoint - 1];
+    rebuildDirty();
+
+    // the end of the leg can't be gone around
+    std::vector<Point> leg;
+    bool found = false;
+    if (!(blocked == to))
+    {
+        bool const was = m_passable.test(blocked.X(), blocked.Y());
+        m_passable.set(blocked.X(), blocked.Y(), false);
+        found = refineLeg(from, to, leg);
+        m_passable.set(blocked.X(), blocked.Y(), was);
+    }
+
+    if (found)
+    {
+        route.m_leg.swap(leg);
+        route.m_next_square = 1;
+        step = route.m_leg.front();
+        route.m_from = step;
+        return true;
+    }
+
+    // creatures move on, so wait to try the same square again. Walls don't
+    if (!m_passable.test(blocked.X(), blocked.Y()))
+    {
+        route.m_leg.clear();
+        route.m_waypoints.clear();
+        return false;
+    }
+    --route.m_next_square;
+    route.m_from = from;
+    step = from;
+    return true;
+}
@@ -0,0 +1,208 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#ifndef H_PATHHIERARCHY_
+#define H_PATHHIERARCHY_ 1
+
+#include <vector>
+
+#include "boost/noncopyable.hpp"
+#include "boost/scoped_ptr.hpp"
+#include "boost/unordered_map.hpp"
+
+#include "bitplane.h"
+#include "handles.h"
+
+class DistanceField;
+class PathFinder;
+
+
+/**
+ * A route found through a PathHierarchy. It holds the abstract waypoints
+ * (entrances between clusters) and the squares of the current leg only;
+ * each leg is refined into squares when the previous one runs out.
+ */
+class HierarchicalPath
+{
+public:
+    HierarchicalPath();
+
+    /**
+     * Has the route been walked to its end (or never found)?
+     *
+     * @return      true if no steps remain
+     */
+    bool empty() const;
+
+    /**
+     * Abstract waypoints of the route, ending with the goal
+     *
+     * @return      waypoints
+     */
+    std::vector<Point> const & getWaypoints() const { return m_waypoints; }
+
+private:
+    friend class PathHierarchy;
+
+    std::vector<Point>  m_waypoints;
+    std::vector<Point>  m_leg;
+    Point               m_from;
+    std::size_t         m_next_waypoint;
+    std::size_t         m_next_square;
+};
+
+
+/**
+ * PathHierarchy is a two level HPA* abstraction of a grid for long routes.
+ * The grid is cut into square clusters. Wherever a run of open squares
+ * crosses between clusters there are entrance nodes, which are joined by
+ * edges holding the walking distance between entrances of the same cluster.
+ * A long query searches this small graph first, and a route is then refined
+ * into squares one leg at a time with a search confined to one cluster.
+ *
+ * The hierarchy keeps its own copy of which squares are passable, and reads
+ * the borders running along rows a word at a time. Changing a square only
+ * marks its cluster; the cluster and its neighbours are rebuilt before the
+ * next query.
+ */
+class PathHierarchy : private boost::noncopyable
+{
+public:
+    /**
+     * Build a hierarchy
+     *
+     * @param clustersize width and height of each cluster
+     * @param passable    passable squares, copied
+     */
+    PathHierarchy(int clustersize, Bitplane const & passable);
+
+    ~PathHierarchy();
+
+    /**
+     * Change whether a square is passable
+     *
+     * @param x           column
+     * @param y           row
+     * @param passable    new passability
+     */
+    void setPassable(int x, int y, bool passable);
+
+    /**
+     * Find an abstract route from s to e. No squares are produced until the
+     * route is walked with nextStep().
+     *
+     * @param s           beginning
+     * @param e           end position
+     * @param route       filled with the abstract route
+     * @return            true if a route was found
+     */
+    bool findRoute(Point s, Point e, HierarchicalPath & route);
+
+    /**
+     * Take the next square of a route, refining the next leg if needed. If
+     * the follower is not on the last square handed out (it was blocked,
+     * or moved some other way) the rest of the leg is refined again from
+     * where it is.
+     *
+     * @param route       route from findRoute()
+     * @param from        square the follower is on
+     * @param step        set to the next square
+     * @return            false at the end of the route, or if a leg can no
+     *                    longer be refined (the terrain has changed, or
+     *                    the follower has strayed out of the leg's cluster)
+     */
+    bool nextStep(HierarchicalPath & route, Point from, Point & step);
+
+    /**
+     * Find a way around a square handed out by nextStep() which turned out
+     * to be blocked, by refining the rest of its leg again without it
+     *
+     * @param route       route from findRoute()
+     * @param from        square the follower is on
+     * @param step        the blocked square; set to the first square of
+     *                    the way around, or to from if there is none yet
+     * @return            false if the square is impassable and there is
+     *                    no way around it, so the route is finished
+     */
+    bool detour(HierarchicalPath & route, Point from, Point & step);
+
+    /**
+     * Number of abstract nodes in the hierarchy
+     *
+     * @return            node count
+     */
+    int getNodeCount() const { return static_cast<int>(m_nodes.size()); }
+
+    /**
+     * Number of abstract nodes expanded by the last findRoute()
+     *
+     * @return            expanded nodes
+     */
+    int getExpanded() const { return m_expanded; }
+
+private:
+    struct Edge
+    {
+        Edge(int t, int c) : to(t), cost(c) {}
+        int to;     // square index of far node
+        int cost;   // steps to reach it
+    };
+
+    struct Node
+    {
+        Node() : cluster(-1), edges() {}
+        int               cluster;
+        std::vector<Edge> edges;
+    };
+
+    struct Transition
+    {
+        int near;   // square in the west/north cluster
+        int far;    // square in the east/south cluster
+    };
+
+    struct Search
+    {
+        int  cost;
+        int  parent;
+        bool closed;
+    };
+
+    struct ClusterPass;
+
+    typedef boost::unordered_map<int, Node>   Nodes;
+    typedef boost::unordered_map<int, Search> Searched;
+    typedef std::vector<Transition>           Transitions;
+
+    int clusterOf(int x, int y) const;
+    void clusterBounds(int cluster, int & x0, int & y0, int & w, int & h) const;
+    void buildBorder(int cluster, bool east);
+    void buildCluster(int cluster);
+    void addTransition(int cluster, int square, int other);
+    void linkWithinCluster(int cluster, int square, bool outward);
+    void rebuildDirty();
+    bool refineLeg(Point from, Point to, std::vector<Point> & leg);
+
+    Bitplane                   m_passable;
+    std::vector<Transitions>   m_east;         // border with cluster to the east
+    std::vector<Transitions>   m_south;        // border with cluster to the south
+    std::vector<std::vector<int> > m_members;  // node squares of each cluster
+    std::vector<char>          m_dirty;
+    std::vector<int>           m_dirtylist;
+    std::vector<std::pair<int, int> > m_temp;  // (node, edge count) to restore
+    Nodes                      m_nodes;
+    Searched                   m_searched;
+    boost::scoped_ptr<DistanceField> m_field;
+    boost::scoped_ptr<PathFinder>    m_local;
+    int                        m_xsize;
+    int                        m_ysize;
+    int                        m_csize;
+    int                        m_cwidth;
+    int                        m_cheight;
+    int                        m_expanded;
+};
+
+
+
+#endif
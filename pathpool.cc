@@ -0,0 +1,150 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#include "boost/bind.hpp"
+
+#include "bitplane.h"
+#include "pathfind.h"
+#include "pathpool.h"
+
+namespace
+{
+    struct PlanesOpen
+    {
+        PlanesOpen(Bitplane const & p, Bitplane const & b) :
+            passable(p), blocked(b), width(p.getWidth()), height(p.getHeight()) {}
+        bool operator()(int x, int y) const
+        {
+            return x >= 0 && y >= 0 && x < width && y < height &&
+                   passable.test(x, y) && !blocked.test(x, y);
+        }
+        Bitplane const & passable;
+        Bitplane const & blocked;
+        int width;
+        int height;
+    };
+}
+
+
+
+//============================================================================
+// PathPool
+//============================================================================
+PathPool::PathPool(int threads) :
+    m_mutex(),
+    m_wake(),
+    m_finished(),
+    m_workers(),
+    m_passable(0),
+    m_blocked(0),
+    m_queries(0),
+    m_finder(),
+    m_next(0),
+    m_solved(0),
+    m_batch(0),
+    m_threads(threads),
+    m_jump(false),
+    m_stop(false)
+{
+    for (int i = 0; i < threads; ++i)
+        m_workers.create_thread(boost::bind(&PathPool::work, this));
+}
+
+
+PathPool::~PathPool()
+{
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    m_workers.join_all();
+}
+
+
+void
+PathPool::solve(Bitplane const & passable, Bitplane const & blocked, bool jump,
+                std::vector<PathQuery> & queries)
+{
+    if (queries.empty())
+        return;
+
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_passable = &passable;
+        m_blocked = &blocked;
+        m_queries = &queries;
+        m_next = 0;
+        m_solved = 0;
+        m_jump = jump;
+        ++m_batch;
+    }
+    m_wake.notify_all();
+    drain(m_finder);
+
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (m_solved < queries.size())
+        m_finished.wait(lock);
+    m_passable = 0;
+    m_blocked = 0;
+    m_queries = 0;
+}
+
+
+void
+PathPool::work()
+{
+    boost::scoped_ptr<PathFinder> finder;
+    unsigned int batch = 0;
+    for (;;)
+    {
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+            while (!m_stop && batch == m_batch)
+                m_wake.wait(lock);
+            if (m_stop)
+                return;
+            batch = m_batch;
+        }
+        drain(finder);
+    }
+}
+
+
+// take queries one at a time until the batch runs out. The batch is only
+// ever read under the lock, so a worker arriving late finds nothing to do
+void
+PathPool::drain(boost::scoped_ptr<PathFinder> & finder)
+{
+    for (;;)
+    {
+        PathQuery * query;
+        Bitplane const * passable;
+        Bitplane const * blocked;
+        bool jump;
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+            if (!m_queries || m_next >= m_queries->size())
+                return;
+            query = &(*m_queries)[m_next++];
+            passable = m_passable;
+            blocked = m_blocked;
+            jump = m_jump;
+        }
+
+        PlanesOpen const pass(*passable, *blocked);
+        if (!finder || finder->getSize().X() != pass.width || finder->getSize().Y() != pass.height)
+            finder.reset(new PathFinder(pass.width, pass.height));
+        Point const s(query->start.X(), query->start.Y());
+        Point const e(query->goal.X(), query->goal.Y());
+        query->found = jump ? finder->findJumpPath(pass, s, e, *query->path) :
+                              finder->findPath(pass, s, e, *query->path);
+
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+            ++m_solved;
+        }
+        m_finished.notify_all();
+    }
+}
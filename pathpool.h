@@ -0,0 +1,102 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#ifndef H_PATHPOOL_
+#define H_PATHPOOL_ 1
+
+#include <vector>
+
+#include "boost/noncopyable.hpp"
+#include "boost/scoped_ptr.hpp"
+#include "boost/thread/condition.hpp"
+#include "boost/thread/mutex.hpp"
+#include "boost/thread/thread.hpp"
+
+#include "handles.h"
+
+class Bitplane;
+class PathFinder;
+
+
+/**
+ * One query of a batch handed to Map::pathFindMany()
+ */
+struct PathQuery
+{
+    PathQuery(Point s, Point e, std::vector<Point> * p) :
+        start(s), goal(e), path(p), found(false) {}
+
+    Point                start;      // beginning
+    Point                goal;       // end position
+    std::vector<Point> * path;       // caller's buffer for the result
+    bool                 found;      // set if a path was found
+};
+
+
+/**
+ * PathPool solves batches of path queries on a fixed set of worker threads.
+ * Every query of a batch is run against the same read-only planes of
+ * passable and blocked squares, and each thread keeps its own PathFinder,
+ * so workers share nothing but the index of the next query to take. The
+ * calling thread works through the batch too, and solve() returns once all
+ * are done. Only one thread may call solve() at a time.
+ */
+class PathPool : private boost::noncopyable
+{
+public:
+    /**
+     * Start the workers
+     *
+     * @param threads  number of threads besides the caller's own
+     */
+    explicit PathPool(int threads);
+
+    /**
+     * Stop and join the workers
+     */
+    ~PathPool();
+
+    /**
+     * Solve a batch of queries. Paths are left as bare coordinates.
+     *
+     * @param passable squares a path may pass through
+     * @param blocked  squares it may not, whatever passable says. The
+     *                 same size as passable. A search never tests its
+     *                 start, so a creature's own square needs no exception
+     * @param jump     use Jump Point Search rather than A*
+     * @param queries  queries to solve in place
+     */
+    void solve(Bitplane const & passable, Bitplane const & blocked, bool jump,
+               std::vector<PathQuery> & queries);
+
+    /**
+     * Number of worker threads
+     *
+     * @return         threads, not counting the caller
+     */
+    int getThreads() const { return m_threads; }
+
+private:
+    void work();
+    void drain(boost::scoped_ptr<PathFinder> & finder);
+
+    boost::mutex              m_mutex;
+    boost::condition          m_wake;         // a new batch or stop
+    boost::condition          m_finished;     // a query has been solved
+    boost::thread_group       m_workers;
+    Bitplane const *          m_passable;
+    Bitplane const *          m_blocked;
+    std::vector<PathQuery> *  m_queries;
+    boost::scoped_ptr<PathFinder> m_finder;   // the caller's
+    std::size_t               m_next;
+    std::size_t               m_solved;
+    unsigned int              m_batch;
+    int                       m_threads;
+    bool                      m_jump;
+    bool                      m_stop;
+};
+
+
+
+#endif
@@ -128,7 +128,7 @@ void
 SDLDisplay::drawCellsToMap(MapH map, int tlx, int tly, int cols, int rows)
 {
     m_main_map->clearAll();
-    Coords const mapsize = map->getSize();
+    Point const mapsize = map->getSize();
     Coords const dispsize = m_main_map->numCells();
     int extrax = (dispsize.X() - cols) / 2;
     int extray = (dispsize.Y() - rows) / 2;
@@ -151,7 +151,7 @@ SDLDisplay::drawCellsToMap(MapH map, int tlx, int tly, int cols, int rows)
         {
             Representation rep(0, Colour::DGrey);
             if (y >= tly && y <  tly + rows && x >= tlx &&x < tlx + cols && map->getSeenGrid(x, y) != Map::Dark)
-                rep = map->getRepresentation(Coords(x, y), HERO);
+                rep = map->getRepresentation(Point(x, y), HERO);
             else
                 rep.first = map->getHeroSeenChar(x, y);
 
@@ -443,7 +443,7 @@ SDLDisplay::drawWizardMap()
     Coords mypos = HERO->getCoords();
     int myposx = mypos.X(); int myposy = mypos.Y();
     MapH mymap = mypos.M();
-    Coords mapsize = mymap->getSize();
+    Point mapsize = mymap->getSize();
 
     SDLMapPanelH pan(new SDLMapPanel(m_options->getSub("WizMiniMap")));
     m_popups.push_back(pan);
@@ -488,7 +488,7 @@ SDLDisplay::drawWizardMap()
             {
                 for (int x = maptlx; x < mapbrx; ++x)
                 {
-                    Representation rep = mymap->getRepresentation(Coords(x, y), HERO);
+                    Representation rep = mymap->getRepresentation(Point(x, y), HERO);
                     pan->plotCharacter(x - maptlx + pantlx, y - maptly + pantly, rep.first, rep.second);
                 }
             }
@@ -0,0 +1,200 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#ifndef H_SHADOWCAST_
+#define H_SHADOWCAST_ 1
+
+#include "bitplane.h"
+
+
+/**
+ * ShadowCaster works out which squares can be seen from a square, by
+ * scanning each octant outwards and casting shadows behind opaque squares.
+ * It lights the same octagon-shaped area as libfov's fov_circle() with
+ * FOV_SHAPE_OCTAGON, FOV_CORNER_NOPEEK and FOV_OPAQUE_APPLY, but the
+ * opacity test and lighting are functors known at compile time, so both
+ * are inlined, and slopes are exact fractions of ints rather than floats.
+ *
+ * Opaque is bool(int x, int y) const, true if the square blocks sight.
+ * Apply is void(int x, int y), called once for each square seen,
+ * opaque squares included. Both see squares off the edge of the map, so
+ * Opaque should treat those as opaque and Apply should ignore them.
+ */
+template<typename Opaque, typename Apply>
+class ShadowCaster
+{
+public:
+    ShadowCaster(Opaque const & opaque, Apply & apply) :
+        m_opaque(opaque), m_apply(apply), m_x(0), m_y(0), m_radius(0) {}
+
+    /**
+     * Light everything seen from a square, the square itself included
+     *
+     * @param x      x-coordinate of viewer
+     * @param y      y-coordinate of viewer
+     * @param radius how far can be seen
+     */
+    void cast(int x, int y, int radius)
+    {
+        m_x = x;
+        m_y = y;
+        m_radius = radius;
+        m_apply(x, y);
+
+        // each octant maps (dx, dy) outwards from the viewer onto the map.
+        // Edges shared by two octants are lit by only one of them
+        scan< 1,  0,  0,  1, true,  true >(1, 0, 1, 1, 1);
+        scan< 0,  1,  1,  0, true,  false>(1, 0, 1, 1, 1);
+        scan< 1,  0,  0, -1, false, true >(1, 0, 1, 1, 1);
+        scan< 0, -1,  1,  0, false, false>(1, 0, 1, 1, 1);
+        scan<-1,  0,  0,  1, true,  true >(1, 0, 1, 1, 1);
+        scan< 0,  1, -1,  0, true,  false>(1, 0, 1, 1, 1);
+        scan<-1,  0,  0, -1, false, true >(1, 0, 1, 1, 1);
+        scan< 0, -1, -1,  0, false, false>(1, 0, 1, 1, 1);
+    }
+
+private:
+    // the row (column) dx squares out of an octant, between slopes sn/sd
+    // and en/ed. Square (dx, dy) is (XX * dx + XY * dy, YX * dx + YY * dy)
+    // from the viewer. Edge lights the dy == 0 edge, and Diagonal the
+    // dy == dx edge
+    template<int XX, int XY, int YX, int YY, bool Edge, bool Diagonal>
+    void scan(int dx, int sn, int sd, int en, int ed)
+    {
+        if (dx > m_radius)
+            return;
+
+        // nearest square to each slope, rounding halves up. Denominators
+        // are always odd, so there are never exact halves to round
+        int const dy0 = (2 * dx * sn + sd) / (2 * sd);
+        int dy1 = (2 * dx * en + ed) / (2 * ed);
+        if (!Diagonal && dy1 == dx)
+            --dy1;
+
+        int const h = (m_radius - dx) * 2;
+        if (dy1 > h)
+        {
+            if (h == 0)
+                return;
+            dy1 = h;
+        }
+
+        int blocked = -1;
+        for (int dy = dy0; dy <= dy1; ++dy)
+        {
+            int const x = m_x + dx * XX + dy * XY;
+            int const y = m_y + dx * YX + dy * YY;
+            if (Edge || dy > 0)
+                m_apply(x, y);
+
+            if (m_opaque(x, y))
+            {
+                // everything past here up to this square is in shadow
+                if (blocked == 0)
+                    scan<XX, XY, YX, YY, Edge, Diagonal>(dx + 1, sn, sd, 2 * dy - 1, 2 * dx + 1);
+                blocked = 1;
+            }
+            else
+            {
+                // the next scan starts past the far corner of the last
+                // opaque square
+                if (blocked == 1)
+                {
+                    sn = 2 * dy - 1;
+                    sd = 2 * dx - 1;
+                }
+                blocked = 0;
+            }
+        }
+
+        if (blocked == 0)
+            scan<XX, XY, YX, YY, Edge, Diagonal>(dx + 1, sn, sd, en, ed);
+    }
+
+    Opaque const & m_opaque;
+    Apply & m_apply;
+    int m_x;
+    int m_y;
+    int m_radius;
+};
+
+
+/**
+ * Light everything seen from a square
+ *
+ * @param opaque bool(int x, int y) const: does a square block sight?
+ * @param apply  void(int x, int y): called for each square seen
+ * @param x      x-coordinate of viewer
+ * @param y      y-coordinate of viewer
+ * @param radius how far can be seen
+ */
+template<typename Opaque, typename Apply>
+inline void
+ShadowCast(Opaque const & opaque, Apply & apply, int x, int y, int radius)
+{
+    ShadowCaster<Opaque, Apply>(opaque, apply).cast(x, y, radius);
+}
+
+
+/**
+ * Opacity test reading a Bitplane of opaque squares, with everything off
+ * the edge of the plane opaque
+ */
+struct OpaquePlane
+{
+    explicit OpaquePlane(Bitplane const & p) :
+        plane(p), width(p.getWidth()), height(p.getHeight()) {}
+
+    bool operator()(int x, int y) const
+    {
+        return x < 0 || y < 0 || x >= width || y >= height || plane.test(x, y);
+    }
+
+    Bitplane const & plane;
+    int width;
+    int height;
+};
+
+
+/**
+ * Lighting which sets the squares seen in a Bitplane, ignoring any off
+ * the edge of it
+ */
+struct LightPlane
+{
+    explicit LightPlane(Bitplane & p) :
+        plane(p), width(p.getWidth()), height(p.getHeight()) {}
+
+    void operator()(int x, int y)
+    {
+        if (x >= 0 && y >= 0 && x < width && y < height)
+            plane.set(x, y, true);
+    }
+
+    Bitplane & plane;
+    int width;
+    int height;
+};
+
+
+/**
+ * Set the squares seen from a square in a Bitplane. Squares already set
+ * are left set.
+ *
+ * @param opaque squares which block sight
+ * @param x      x-coordinate of viewer
+ * @param y      y-coordinate of viewer
+ * @param radius how far can be seen
+ * @param lit    squares seen are set, the same size as opaque
+ */
+inline void
+ShadowCast(Bitplane const & opaque, int x, int y, int radius, Bitplane & lit)
+{
+    LightPlane light(lit);
+    ShadowCast(OpaquePlane(opaque), light, x, y, radius);
+}
+
+
+
+#endif
@@ -0,0 +1,176 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+// Takes an Overworld map full of monsters abstract, passes time and brings
+// it back. No Actor may act meanwhile; afterwards the monsters must be on
+// free passable squares, new ones spawned up to the cap and no further,
+// and every Actor moved up to the present with the queue in turn order.
+// Passing time in one go or in small steps must come to the same thing,
+// and a map dropped while abstract must be left alone.
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+#include "boost/test/minimal.hpp"
+
+#include "abstractmaps.h"
+#include "creature.h"
+#include "dice.h"
+#include "dungeonmaster.h"
+#include "map.h"
+#include "monster.h"
+
+
+namespace
+{
+    int const Size = 96;
+    int const Start = 30;
+    unsigned int const Quantum = 120;
+
+    struct Level
+    {
+        DungeonMasterH dm;
+        MapH           mp;
+    };
+
+    Level Build(int seed, unsigned int interval, int cap)
+    {
+        Dice dice(0, 32767, seed);
+        Dice::Stream stream(dice);
+        Level level;
+        level.dm = DungeonMaster::theFactory().create("overworld", "overworld");
+        level.dm->setLevelSize(Size, Size);
+        level.dm->setAbstractSpawning(interval, cap);
+        level.mp = level.dm->getOrCreateMap(0);
+        for (int i = 0; i < Start; ++i)
+            level.mp->addCreature(Map::Random, Monster::createMonster(Species::Human));
+        return level;
+    }
+
+    std::vector<Point> Positions(MapH mp)
+    {
+        std::vector<CreatureH> creatures;
+        mp->getCreatures(creatures);
+        std::vector<Point> out;
+        for (std::size_t i = 0; i < creatures.size(); ++i)
+            out.push_back(creatures[i]->getCoords());
+        std::sort(out.begin(), out.end());
+        return out;
+    }
+
+    // every creature where the map says it is, on a passable square, and
+    // moved up to now but no further than one of its own turns
+    bool Settled(MapH mp, unsigned int now)
+    {
+        std::vector<CreatureH> creatures;
+        mp->getCreatures(creatures);
+        bool ok = !creatures.empty();
+        unsigned int first = ~0U;
+        for (std::size_t i = 0; i < creatures.size(); ++i)
+        {
+            CreatureH const & cr = creatures[i];
+            Point const at = cr->getCoords();
+            unsigned int const turn = cr->getTurn();
+            ok = ok && cr->getCoords().M() == mp && mp->getCreature(at) == cr && mp->isPassable(at, cr);
+            ok = ok && turn >= now && turn < now + cr->getSpeed();
+            first = std::min(first, turn);
+        }
+        return ok && mp->getNextTurn() == first;
+    }
+
+    // take the Actors off the queue one by one; turns must never go back
+    bool InTurnOrder(MapH mp)
+    {
+        unsigned int last = 0;
+        bool ok = true;
+        while (mp->getNextTurn() != ~0U)
+        {
+            ActorH const next = mp->getNextActor();
+            ok = ok && next->getTurn() >= last;
+            last = next->getTurn();
+            mp->delCreature(next->getCoords());
+        }
+        return ok;
+    }
+
+    void CheckRoundTrip()
+    {
+        int const cap = Start + 5;
+        Level level = Build(3, 100, cap);
+        std::vector<Point> const before = Positions(level.mp);
+
+        AbstractMaps abstract(Quantum);
+        abstract.add(level.mp, level.dm, 0);
+        BOOST_CHECK(abstract.contains(level.mp));
+        abstract.advance(Quantum - 1);
+        BOOST_CHECK(Positions(level.mp) == before);
+        abstract.advance(1000);
+        BOOST_CHECK(level.mp->getNextTurn() == 0);
+
+        abstract.restore(level.mp, 1050);
+        BOOST_CHECK(!abstract.contains(level.mp));
+        BOOST_CHECK(abstract.empty());
+        std::vector<Point> const after = Positions(level.mp);
+        BOOST_CHECK(static_cast<int>(after.size()) == cap);
+        BOOST_CHECK(after != before);
+        BOOST_CHECK(std::set<Point>(after.begin(), after.end()).size() == after.size());
+        BOOST_CHECK(Settled(level.mp, 1050));
+        BOOST_CHECK(InTurnOrder(level.mp));
+    }
+
+    void CheckNoSpawning()
+    {
+        Level level = Build(4, 0, 1000);
+        AbstractMaps abstract(Quantum);
+        abstract.add(level.mp, level.dm, 500);
+        abstract.advance(5000);
+        abstract.restore(level.mp, 5000);
+        BOOST_CHECK(static_cast<int>(Positions(level.mp).size()) == Start);
+        BOOST_CHECK(Settled(level.mp, 5000));
+    }
+
+    void CheckSteps()
+    {
+        Level once = Build(5, 50, Start + 20);
+        Level steps = Build(5, 50, Start + 20);
+        BOOST_CHECK(Positions(once.mp) == Positions(steps.mp));
+
+        AbstractMaps abstract_once(Quantum);
+        abstract_once.add(once.mp, once.dm, 0);
+        abstract_once.advance(2000);
+        abstract_once.restore(once.mp, 2000);
+
+        AbstractMaps abstract_steps(Quantum);
+        abstract_steps.add(steps.mp, steps.dm, 0);
+        for (unsigned int turn = 0; turn <= 2000; turn += 7)
+            abstract_steps.advance(turn);
+        abstract_steps.restore(steps.mp, 2000);
+        BOOST_CHECK(Positions(once.mp) == Positions(steps.mp));
+    }
+
+    void CheckRemove()
+    {
+        Level level = Build(6, 10, Start + 50);
+        std::vector<Point> const before = Positions(level.mp);
+        AbstractMaps abstract(Quantum);
+        abstract.add(level.mp, level.dm, 0);
+        abstract.remove(level.mp);
+        abstract.remove(level.mp);
+        BOOST_CHECK(abstract.empty());
+        abstract.advance(5000);
+        BOOST_CHECK(Positions(level.mp) == before);
+        BOOST_CHECK(level.mp->getNextTurn() == 0);
+    }
+}
+
+
+int test_main(int, char **)
+{
+    CheckRoundTrip();
+    CheckNoSpawning();
+    CheckSteps();
+    CheckRemove();
+    return 0;
+}
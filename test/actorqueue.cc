@@ -0,0 +1,166 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+// Checks the turn order a Map's ActorQueue keeps: Actors on equal turns
+// come out in the order they were pushed or last rescheduled, and removing
+// one from the middle of the heap leaves the rest in order. Then puts a
+// Map through thousands of random adds, reschedules and removals against
+// a plain list kept in turn order.
+
+#include <algorithm>
+#include <vector>
+
+#include "boost/test/minimal.hpp"
+
+#include "creature.h"
+#include "dice.h"
+#include "map.h"
+#include "monster.h"
+
+
+namespace
+{
+    int const Size = 32;
+
+    // the next Actor each time one is taken off the map
+    std::vector<ActorH> Drain(MapH mp)
+    {
+        std::vector<ActorH> out;
+        while (mp->getNextTurn() != ~0U)
+        {
+            out.push_back(mp->getNextActor());
+            mp->delCreature(out.back()->getCoords());
+        }
+        return out;
+    }
+
+    std::vector<CreatureH> Populate(MapH mp, int count)
+    {
+        std::vector<CreatureH> out;
+        for (int i = 0; i < count; ++i)
+        {
+            out.push_back(Monster::createMonster(Species::Human));
+            mp->addCreature(Point(i % Size, i / Size), out.back());
+        }
+        return out;
+    }
+
+    void CheckPushOrder()
+    {
+        MapH mp(new Map(Size, Size, Map::DirtFloor));
+        std::vector<CreatureH> const creatures = Populate(mp, 50);
+        std::vector<ActorH> const got = Drain(mp);
+        BOOST_CHECK(std::equal(got.begin(), got.end(), creatures.begin()));
+    }
+
+    void CheckRescheduleOrder()
+    {
+        MapH mp(new Map(Size, Size, Map::DirtFloor));
+        std::vector<CreatureH> creatures = Populate(mp, 50);
+        std::random_shuffle(creatures.begin(), creatures.end(), Dice::Random0);
+
+        // all land on turn 5, some by way of later turns and some by way
+        // of none at all, so only the order of rescheduling tells them apart
+        for (std::size_t i = 0; i < creatures.size(); ++i)
+            mp->updateActor(creatures[i], i % 3 ? 5 : 0);
+        for (std::size_t i = 0; i < creatures.size(); i += 3)
+            mp->updateActor(creatures[i], 5);
+        std::vector<CreatureH> want;
+        for (std::size_t i = 0; i < creatures.size(); ++i)
+            if (i % 3)
+                want.push_back(creatures[i]);
+        for (std::size_t i = 0; i < creatures.size(); i += 3)
+            want.push_back(creatures[i]);
+
+        std::vector<ActorH> const got = Drain(mp);
+        BOOST_CHECK(got.size() == want.size() && std::equal(got.begin(), got.end(), want.begin()));
+    }
+
+    void CheckRemoveMiddle()
+    {
+        MapH mp(new Map(Size, Size, Map::DirtFloor));
+        std::vector<CreatureH> const creatures = Populate(mp, 63);
+        for (std::size_t i = 0; i < creatures.size(); ++i)
+            mp->updateActor(creatures[i], static_cast<unsigned int>(i));
+
+        // every other one, from deep in the heap as well as near the top
+        std::vector<CreatureH> want;
+        for (std::size_t i = 0; i < creatures.size(); ++i)
+        {
+            if (i % 2)
+                mp->delCreature(creatures[i]->getCoords());
+            else
+                want.push_back(creatures[i]);
+        }
+        std::vector<ActorH> const got = Drain(mp);
+        BOOST_CHECK(got.size() == want.size() && std::equal(got.begin(), got.end(), want.begin()));
+    }
+
+    // turn, then order queued or rescheduled
+    struct Entry
+    {
+        unsigned int turn;
+        long         seq;
+        CreatureH    cr;
+        bool operator<(Entry const & r) const { return turn < r.turn || (turn == r.turn && seq < r.seq); }
+    };
+
+    void CheckRandom(int ops)
+    {
+        MapH mp(new Map(Size, Size, Map::DirtFloor));
+        std::vector<Entry> want;
+        long seq = 0;
+        bool same = true;
+        for (int op = 0; op < ops; ++op)
+        {
+            int const roll = Dice::Random0(10);
+            if (want.empty() || (roll < 3 && static_cast<int>(want.size()) < Size * Size))
+            {
+                Point c;
+                do
+                    c = Point(Dice::Random0(Size), Dice::Random0(Size));
+                while (mp->getCreature(c));
+                Entry const e = { 0, seq++, Monster::createMonster(Species::Human) };
+                mp->addCreature(c, e.cr);
+                want.push_back(e);
+            }
+            else if (roll < 8)
+            {
+                Entry & e = want[Dice::Random0(static_cast<int>(want.size()))];
+                unsigned int const nt = Dice::Random0(4) * 2;
+                mp->updateActor(e.cr, nt);
+                e.turn += nt;
+                e.seq = seq++;
+            }
+            else
+            {
+                std::size_t const i = Dice::Random0(static_cast<int>(want.size()));
+                mp->delCreature(want[i].cr->getCoords());
+                want.erase(want.begin() + i);
+            }
+
+            if (!want.empty())
+                same = same && mp->getNextActor() == std::min_element(want.begin(), want.end())->cr;
+        }
+        BOOST_CHECK(same);
+
+        std::sort(want.begin(), want.end());
+        std::vector<ActorH> const got = Drain(mp);
+        same = got.size() == want.size();
+        for (std::size_t i = 0; same && i < got.size(); ++i)
+            same = got[i] == want[i].cr;
+        BOOST_CHECK(same);
+    }
+}
+
+
+int test_main(int, char **)
+{
+    CheckPushOrder();
+    CheckRescheduleOrder();
+    CheckRemoveMiddle();
+    CheckRandom(200);
+    CheckRandom(20000);
+    return 0;
+}
@@ -0,0 +1,72 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+// Helpers shared by the benchmarks
+
+#ifndef H_BENCHUTIL_
+#define H_BENCHUTIL_ 1
+
+#include <ctime>
+
+#include "dice.h"
+#include "dmutils.h"
+#include "handles.h"
+#include "map.h"
+
+
+/**
+ * Processor time since a clock() reading
+ *
+ * @param begin    earlier std::clock()
+ * @return         seconds
+ */
+inline double
+Seconds(std::clock_t begin)
+{
+    return double(std::clock() - begin) / CLOCKS_PER_SEC;
+}
+
+
+/**
+ * A random square of a Map which is passable and has no Creature on it.
+ * Never returns if there is none.
+ *
+ * @param mp       Map
+ * @return         square
+ */
+inline Point
+RandomOpenSquare(MapH mp)
+{
+    Point size = mp->getSize();
+    for (;;)
+    {
+        Point c(Dice::Random0(size.X()), Dice::Random0(size.Y()));
+        if (mp->isPassable(c, CreatureH()) && !mp->getCreature(c))
+            return c;
+    }
+}
+
+
+/**
+ * A random square of a generated layout which is not '#'. Never returns
+ * if there is none.
+ *
+ * @param cv       layout, as from DMUtils::CellularAutomata
+ * @param size     width and height of layout
+ * @return         square
+ */
+inline Point
+RandomOpenSquare(DMUtils::CharVec const & cv, int size)
+{
+    for (;;)
+    {
+        Point c(Dice::Random0(size), Dice::Random0(size));
+        if (cv[c.Y() * size + c.X()] != '#')
+            return c;
+    }
+}
+
+
+
+#endif
@@ -0,0 +1,136 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+// Scatters thousands of monsters over a large open map, then compares
+// finding the creatures near a square through Map's bucket index with
+// checking every creature on the map. Both must find the same creatures.
+// Also times moving creatures, which keeps the index up to date.
+
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+#include "boost/test/minimal.hpp"
+
+#include "benchutil.h"
+#include "creature.h"
+#include "dice.h"
+#include "map.h"
+#include "monster.h"
+
+
+namespace
+{
+    int const Queries = 2000;
+
+    struct Count
+    {
+        Count() : found(0) {}
+        bool operator()(CreatureH const &, Point) { ++found; return true; }
+        long found;
+    };
+
+    long ScanRadius(std::vector<CreatureH> const & all, Point c, int radius)
+    {
+        long found = 0;
+        for (std::vector<CreatureH>::const_iterator it = all.begin(); it != all.end(); ++it)
+        {
+            Point const at = (*it)->getCoords();
+            int const dx = at.X() - c.X();
+            int const dy = at.Y() - c.Y();
+            if (dx * dx + dy * dy <= radius * radius)
+                ++found;
+        }
+        return found;
+    }
+
+    long ScanRect(std::vector<CreatureH> const & all, Point tl, Point br)
+    {
+        long found = 0;
+        for (std::vector<CreatureH>::const_iterator it = all.begin(); it != all.end(); ++it)
+        {
+            Point const at = (*it)->getCoords();
+            if (at.X() >= tl.X() && at.X() <= br.X() && at.Y() >= tl.Y() && at.Y() <= br.Y())
+                ++found;
+        }
+        return found;
+    }
+
+    void Bench(int size, int creatures, int radius)
+    {
+        MapH mp(new Map(size, size, Map::Grass));
+        for (int i = 0; i < creatures; )
+        {
+            Point const c(Dice::Random0(size), Dice::Random0(size));
+            if (mp->getCreature(c))
+                continue;
+            mp->addCreature(c, Monster::createMonster(Species::Human));
+            ++i;
+        }
+
+        std::vector<Point> centres;
+        for (int i = 0; i < Queries; ++i)
+            centres.push_back(Point(Dice::Random0(size), Dice::Random0(size)));
+
+        std::vector<CreatureH> all;
+        mp->getCreatures(all);
+
+        Count radius_found;
+        std::clock_t begin = std::clock();
+        for (int i = 0; i < Queries; ++i)
+            mp->visitCreaturesInRadius(centres[i], radius, radius_found);
+        double const radius_time = Seconds(begin);
+
+        Count rect_found;
+        begin = std::clock();
+        for (int i = 0; i < Queries; ++i)
+            mp->visitCreaturesInRect(centres[i] - Point(radius, radius), centres[i] + Point(radius, radius),
+                                     rect_found);
+        double const rect_time = Seconds(begin);
+
+        Count ring_found;
+        begin = std::clock();
+        for (int i = 0; i < Queries; ++i)
+            mp->visitCreaturesInRing(centres[i], radius / 2, radius, ring_found);
+        double const ring_time = Seconds(begin);
+
+        long scan_radius = 0, scan_rect = 0;
+        begin = std::clock();
+        for (int i = 0; i < Queries; ++i)
+        {
+            scan_radius += ScanRadius(all, centres[i], radius);
+            scan_rect += ScanRect(all, centres[i] - Point(radius, radius), centres[i] + Point(radius, radius));
+        }
+        double const scan_time = Seconds(begin);
+        BOOST_CHECK(radius_found.found == scan_radius);
+        BOOST_CHECK(rect_found.found == scan_rect);
+        BOOST_CHECK(ring_found.found <= radius_found.found);
+
+        // every creature takes one step, as they would in a turn
+        begin = std::clock();
+        for (std::vector<CreatureH>::iterator it = all.begin(); it != all.end(); ++it)
+        {
+            Point const at = (*it)->getCoords();
+            Point const to(at.X() + Dice::Random0(3) - 1, at.Y() + Dice::Random0(3) - 1);
+            if (mp->getSize().containsPoint(to) && !mp->getCreature(to))
+                mp->moveCreature(to, *it);
+        }
+        double const move_time = Seconds(begin);
+
+        std::cout << size << "x" << size << ", " << creatures << " creatures, radius " << radius
+                  << ": radius " << radius_time << "s, rect " << rect_time << "s, ring "
+                  << ring_time << "s; scanning every creature " << scan_time << "s ("
+                  << Queries << " queries); moving all " << move_time << "s" << std::endl;
+    }
+}
+
+
+int test_main(int, char **)
+{
+    Bench(256, 1000, 8);
+    Bench(1024, 5000, 8);
+    Bench(1024, 5000, 32);
+    Bench(2048, 20000, 8);
+    return 0;
+}
@@ -0,0 +1,288 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+// Stores chunks of long runs, of noise and of a mix of both in a
+// ChunkCache, rewriting them larger and smaller, and every one must load
+// back unchanged. Then evicts and reloads a ChunkedGrid with a source,
+// which must keep what was written and write nothing for chunks left
+// alone. Last, builds Overworld maps, whose terrain comes from a source,
+// so evicting them must write nothing until terrain is changed, and
+// reading only the squares around one spot must only bring in the chunks
+// under them; the memory held is reported against a dense layer. Also
+// checks the sparse per-square sets a Map keeps beside its chunks,
+// FreeCells and OccupancyLayer, against plain arrays.
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+#include "boost/test/minimal.hpp"
+
+#include "benchutil.h"
+#include "chunkgrid.h"
+#include "dice.h"
+#include "dungeonmaster.h"
+#include "freecells.h"
+#include "map.h"
+#include "occupancy.h"
+
+
+namespace
+{
+    typedef std::vector<unsigned char> Bytes;
+
+    enum Pattern { Runs, Noise, Mixed };
+
+    // count squares of size bytes each
+    Bytes Make(Pattern pattern, std::size_t count, std::size_t size)
+    {
+        Bytes out(count * size);
+        std::size_t i = 0;
+        while (i < count)
+        {
+            // runs from a single square to several times the longest the
+            // cache writes in one go
+            std::size_t run = pattern == Noise ? 1 :
+                              pattern == Runs ? 1 + Dice::Random0(1000) :
+                              Dice::Random0(2) ? 1 : 1 + Dice::Random0(300);
+            run = std::min(run, count - i);
+            Bytes square(size);
+            for (std::size_t b = 0; b < size; ++b)
+                square[b] = static_cast<unsigned char>(Dice::Random0(pattern == Noise ? 256 : 3));
+            for (std::size_t r = 0; r < run; ++r, ++i)
+                std::memcpy(&out[i * size], &square[0], size);
+        }
+        return out;
+    }
+
+    bool Loads(ChunkCache const & cache, int chunk, Bytes const & want, std::size_t size)
+    {
+        Bytes got(want.size(), 0xff);
+        return cache.load(chunk, &got[0], want.size() / size, size) && got == want;
+    }
+
+    void CheckCache(std::size_t size)
+    {
+        std::size_t const count = 64 * 64;
+        Pattern const patterns[] = { Runs, Noise, Mixed, Runs };
+        ChunkCache cache;
+        Bytes scratch(count * size);
+        BOOST_CHECK(!cache.load(0, &scratch[0], count, size));
+
+        // each chunk goes through every pattern, so is rewritten both in
+        // place and at the end of the file
+        std::vector<Bytes> stored(3);
+        for (int round = 0; round < 4; ++round)
+        {
+            for (int chunk = 0; chunk < 3; ++chunk)
+            {
+                stored[chunk] = Make(patterns[(round + chunk) % 4], count, size);
+                cache.store(chunk, &stored[chunk][0], count, size);
+            }
+            for (int chunk = 0; chunk < 3; ++chunk)
+                BOOST_CHECK(Loads(cache, chunk, stored[chunk], size));
+        }
+
+        // one square, and one run of the lot
+        Bytes const one = Make(Noise, 1, size);
+        cache.store(3, &one[0], 1, size);
+        BOOST_CHECK(Loads(cache, 3, one, size));
+        Bytes const same(count * size, 7);
+        cache.store(4, &same[0], count, size);
+        BOOST_CHECK(Loads(cache, 4, same, size));
+        BOOST_CHECK(Loads(cache, 0, stored[0], size));
+
+        cache.clear();
+        BOOST_CHECK(!cache.load(0, &scratch[0], count, size));
+    }
+
+    struct Pattern2D : public ChunkSource<int>
+    {
+        void generate(int x0, int y0, int w, int h, int *out) const
+        {
+            for (int y = 0; y < h; ++y)
+                for (int x = 0; x < w; ++x)
+                    out[(y << ChunkedGrid<int>::ChunkShift) + x] = Value(x0 + x, y0 + y);
+        }
+
+        static int Value(int x, int y) { return (x / 3) * 1000 + y / 5; }
+    };
+
+    void CheckGrid(int width, int height)
+    {
+        ChunkedGrid<int> grid(width, height, -1);
+        grid.setSource(ChunkedGrid<int>::SourceH(new Pattern2D));
+        std::vector<int> want(width * height);
+        for (int y = 0; y < height; ++y)
+            for (int x = 0; x < width; ++x)
+                want[y * width + x] = Pattern2D::Value(x, y);
+
+        // reading everything and evicting it costs nothing
+        for (int y = 0; y < height; ++y)
+            for (int x = 0; x < width; ++x)
+                grid.get(x, y);
+        grid.evict(0);
+        BOOST_CHECK(grid.getCacheBytes() == 0);
+        BOOST_CHECK(grid.getResidentChunks() == 0);
+
+        // change squares scattered over the grid
+        for (int y = 0; y < height; y += 37)
+            for (int x = 0; x < width; x += 53)
+            {
+                int const v = Dice::Random0(100000);
+                grid.set(x, y, v);
+                want[y * width + x] = v;
+            }
+        grid.evict(0);
+        long const bytes = grid.getCacheBytes();
+        BOOST_CHECK(bytes > 0);
+
+        bool same = true;
+        for (int y = 0; y < height; ++y)
+            for (int x = 0; x < width; ++x)
+                same = same && grid.get(x, y) == want[y * width + x];
+        BOOST_CHECK(same);
+
+        // chunks read back but not changed are already in the cache
+        grid.evict(0);
+        BOOST_CHECK(grid.getCacheBytes() == bytes);
+    }
+
+    void CheckFreeCells(int squares)
+    {
+        FreeCells cells(squares);
+        std::vector<char> want(squares, 0);
+        bool same = true;
+        for (int round = 0; round < 20; ++round)
+        {
+            // fill up, then thin out
+            int const changes = squares / 4;
+            for (int i = 0; i < changes; ++i)
+            {
+                int const index = Dice::Random0(squares);
+                bool const free = round % 4 != 3 ? Dice::Random0(4) != 0 : Dice::Random0(4) == 0;
+                cells.set(index, free);
+                want[index] = free;
+            }
+
+            std::vector<int> listed;
+            for (int i = 0; i < squares; ++i)
+                if (want[i])
+                    listed.push_back(i);
+            same = same && cells.size() == listed.size();
+            for (std::size_t n = 0; same && n < listed.size(); ++n)
+                same = cells.get(n) == listed[n] && cells.contains(listed[n]);
+        }
+        BOOST_CHECK(same);
+    }
+
+    void CheckOccupancy(int squares)
+    {
+        OccupancyLayer<int> layer(squares);
+        std::vector<int> want(squares, 0);
+        bool same = true;
+        for (int i = 0; i < squares * 4; ++i)
+        {
+            int const index = Dice::Random0(squares);
+            if (Dice::Random0(3))
+            {
+                bool const empty = want[index] == 0;
+                same = same && layer.insert(index, i + 1) == empty;
+                if (empty)
+                    want[index] = i + 1;
+            }
+            else
+            {
+                same = same && layer.take(index) == want[index];
+                want[index] = 0;
+            }
+        }
+
+        std::size_t occupied = 0;
+        for (int i = 0; i < squares; ++i)
+        {
+            same = same && layer.occupied(i) == (want[i] != 0) && layer.get(i) == want[i];
+            occupied += want[i] != 0;
+        }
+        BOOST_CHECK(same);
+        BOOST_CHECK(layer.size() == occupied);
+    }
+
+    void BenchOverworld(int size)
+    {
+        DungeonMasterH dm = DungeonMaster::theFactory().create("overworld", "overworld");
+        dm->setLevelSize(size, size);
+        std::clock_t begin = std::clock();
+        MapH mp = dm->getOrCreateMap(0);
+        double const build = Seconds(begin);
+
+        long const built = mp->getResidentChunkBytes();
+        std::vector<int> terrain(size * size);
+        for (int y = 0; y < size; ++y)
+            for (int x = 0; x < size; ++x)
+                terrain[y * size + x] = mp->getTerrain(Point(x, y));
+        long const everything = mp->getResidentChunkBytes();
+        begin = std::clock();
+        std::size_t const evicted = mp->evictChunks(0);
+        double const evict = Seconds(begin);
+        BOOST_CHECK(evicted > 0);
+        BOOST_CHECK(mp->getChunkCacheBytes() == 0);
+        BOOST_CHECK(mp->getResidentChunkBytes() == 0);
+
+        // a hero's surroundings only bring in the chunks under them
+        int const window = std::min(size, 256);
+        for (int y = (size - window) / 2; y < (size + window) / 2; ++y)
+            for (int x = (size - window) / 2; x < (size + window) / 2; ++x)
+                mp->getTerrain(Point(x, y));
+        long const around = mp->getResidentChunkBytes();
+        long const chunks = (window / 64 + 1) * (window / 64 + 1);
+        BOOST_CHECK(around > 0 && around <= chunks * 64 * 64 * static_cast<long>(sizeof(Map::Terrain)));
+        mp->evictChunks(0);
+
+        // generated again, it must come out the same
+        bool same = true;
+        for (int y = 0; y < size; ++y)
+            for (int x = 0; x < size; ++x)
+                same = same && mp->getTerrain(Point(x, y)) == terrain[y * size + x];
+        BOOST_CHECK(same);
+
+        // only the chunk changed is written
+        Point const c(size / 2, size / 2);
+        Map::Terrain const t = mp->getTerrain(c) == Map::Grass ? Map::Tree : Map::Grass;
+        mp->setTerrain(c, t);
+        mp->evictChunks(0);
+        BOOST_CHECK(mp->getChunkCacheBytes() > 0);
+        BOOST_CHECK(mp->getChunkCacheBytes() < 64 * 64 * static_cast<long>(sizeof(Map::Terrain)));
+        BOOST_CHECK(mp->getTerrain(c) == t);
+
+        long const squares = static_cast<long>(size) * size;
+        std::cout << "overworld " << size << "x" << size << ": built in " << build
+                  << "s, " << evicted << " chunks evicted in " << evict << "s; chunks in memory "
+                  << built / 1024 << "KB once built, " << everything / 1024 << "KB with every square read, "
+                  << around / 1024 << "KB for a " << window << "x" << window << " window, against "
+                  << squares * static_cast<long>(sizeof(Map::Terrain)) / 1024 << "KB for dense terrain. Bit planes "
+                  << squares / 2 / 1024 << "KB, always" << std::endl;
+    }
+}
+
+
+int test_main(int, char **)
+{
+    CheckCache(1);
+    CheckCache(2);
+    CheckCache(4);
+    CheckCache(12);
+    CheckGrid(64, 64);
+    CheckGrid(200, 150);
+    CheckFreeCells(100);
+    CheckFreeCells(20000);
+    CheckOccupancy(100);
+    CheckOccupancy(20000);
+    BenchOverworld(256);
+    BenchOverworld(1000);
+    BenchOverworld(4096);
+    return 0;
+}
@@ -0,0 +1,205 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+// Times libfov's fov_circle, driven through callbacks as Display drives
+// it, against the templated ShadowCast, on CellularAutomata caves. Both
+// must light exactly the same squares from every viewpoint. Then times
+// redrawing without moving through FOVCache, which must shadowcast again
+// only when walls near the viewer change.
+
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+#include "boost/test/minimal.hpp"
+
+#include "benchutil.h"
+#include "bitplane.h"
+#include "dice.h"
+#include "dmutils.h"
+#include "fov.h"
+#include "fovcache.h"
+#include "map.h"
+#include "shadowcast.h"
+
+
+namespace
+{
+    int const Origins = 20000;
+
+    struct Cave
+    {
+        Cave(Bitplane const & o, Bitplane & l) : opaque(o), lit(l), count(0) {}
+        Bitplane const & opaque;
+        Bitplane & lit;
+        long count;
+    };
+
+    bool IsOpaque(void *map, int x, int y)
+    {
+        Bitplane const & opaque = static_cast<Cave *>(map)->opaque;
+        if (x < 0 || y < 0 || x >= opaque.getWidth() || y >= opaque.getHeight())
+            return true;
+        return opaque.test(x, y);
+    }
+
+    void LightCell(void *map, int x, int y, int, int, void *)
+    {
+        Bitplane & lit = static_cast<Cave *>(map)->lit;
+        if (x >= 0 && y >= 0 && x < lit.getWidth() && y < lit.getHeight())
+            lit.set(x, y, true);
+    }
+
+    void CountCell(void *map, int, int, int, int, void *)
+    {
+        ++static_cast<Cave *>(map)->count;
+    }
+
+    struct Count
+    {
+        Count() : count(0) {}
+        void operator()(int, int) { ++count; }
+        long count;
+    };
+
+    // count and clear the squares lit around a viewpoint
+    long Collect(Bitplane & lit, int cx, int cy, int radius, std::vector<int> & squares)
+    {
+        long count = 0;
+        for (int y = cy - radius; y <= cy + radius; ++y)
+            for (int x = cx - radius; x <= cx + radius; ++x)
+                if (lit.test(x, y))
+                {
+                    squares.push_back(y * lit.getWidth() + x);
+                    lit.set(x, y, false);
+                    ++count;
+                }
+        return count;
+    }
+
+    void Bench(int size, int radius)
+    {
+        DMUtils::CharVec const cv = DMUtils::CellularAutomata(size, size, '#', 45, 4, 5, 4, true);
+        Bitplane opaque(size, size);
+        for (int i = 0; i < size * size; ++i)
+            opaque.set(i % size, i / size, cv[i] == '#');
+
+        std::vector<int> xs, ys;
+        while (static_cast<int>(xs.size()) < Origins)
+        {
+            int const x = Dice::Random0(size);
+            int const y = Dice::Random0(size);
+            if (!opaque.test(x, y))
+            {
+                xs.push_back(x);
+                ys.push_back(y);
+            }
+        }
+
+        Bitplane lit(size, size);
+        Cave cave(opaque, lit);
+        fov_settings_type fov;
+        fov_settings_init(&fov);
+        fov_settings_set_shape(&fov, FOV_SHAPE_OCTAGON);
+        fov_settings_set_corner_peek(&fov, FOV_CORNER_NOPEEK);
+        fov_settings_set_opaque_apply(&fov, FOV_OPAQUE_APPLY);
+        fov_settings_set_opacity_test_function(&fov, IsOpaque);
+        fov_settings_set_apply_lighting_function(&fov, LightCell);
+
+        // first check both light the same squares
+        std::vector<int> libfov_squares;
+        for (int i = 0; i < Origins; ++i)
+        {
+            fov_circle(&fov, &cave, 0, xs[i], ys[i], radius);
+            LightCell(&cave, xs[i], ys[i], 0, 0, 0);
+            Collect(lit, xs[i], ys[i], radius, libfov_squares);
+        }
+        std::vector<int> shadow_squares;
+        for (int i = 0; i < Origins; ++i)
+        {
+            ShadowCast(opaque, xs[i], ys[i], radius, lit);
+            Collect(lit, xs[i], ys[i], radius, shadow_squares);
+        }
+        BOOST_CHECK(libfov_squares == shadow_squares);
+
+        // then time them doing nothing more than counting squares
+        fov_settings_set_apply_lighting_function(&fov, CountCell);
+        std::clock_t begin = std::clock();
+        for (int i = 0; i < Origins; ++i)
+            fov_circle(&fov, &cave, 0, xs[i], ys[i], radius);
+        double const libfov_time = Seconds(begin);
+        fov_settings_free(&fov);
+
+        Count count;
+        OpaquePlane const test(opaque);
+        begin = std::clock();
+        for (int i = 0; i < Origins; ++i)
+            ShadowCast(test, count, xs[i], ys[i], radius);
+        double const shadow_time = Seconds(begin);
+        BOOST_CHECK(count.count == cave.count + Origins);
+
+        std::cout << "cave " << size << "x" << size << ", radius " << radius << ": libfov "
+                  << libfov_time << "s, ShadowCast " << shadow_time << "s (" << Origins
+                  << " viewpoints, " << shadow_squares.size() << " squares lit)" << std::endl;
+    }
+
+    void BenchCache(int size, int radius)
+    {
+        DMUtils::CharVec const cv = DMUtils::CellularAutomata(size, size, '#', 45, 4, 5, 4, true);
+        MapH mp(new Map(size, size, Map::DirtFloor));
+        Point origin;
+        for (int i = 0; i < size * size; ++i)
+            if (cv[i] == '#')
+                mp->setTerrain(Point(i % size, i / size), Map::RockWall);
+            else
+                origin = Point(i % size, i / size);
+
+        Bitplane lit(size, size);
+        std::vector<int> cast;
+        ShadowCast(mp->getOpaquePlane(), origin.X(), origin.Y(), radius, lit);
+        Collect(lit, origin.X(), origin.Y(), radius, cast);
+
+        FOVCache cache;
+        std::clock_t begin = std::clock();
+        for (int i = 0; i < Origins; ++i)
+            cache.getVisible(*mp, origin, radius);
+        double const cached_time = Seconds(begin);
+        BOOST_CHECK(cache.getCasts() == 1);
+
+        // walls out of sight change nothing; those in sight are cast again
+        Point const far(origin.X() < size / 2 ? size - 1 : 0, origin.Y() < size / 2 ? size - 1 : 0);
+        mp->setTerrain(far, Map::DirtFloor);
+        cache.getVisible(*mp, origin, radius);
+        BOOST_CHECK(cache.getCasts() == 1);
+        Point const near(origin.X() + (origin.X() > 0 ? -1 : 1), origin.Y());
+        mp->setTerrain(near, Map::RockWall);
+        std::vector<Point> const & seen = cache.getVisible(*mp, origin, radius);
+        BOOST_CHECK(cache.getCasts() == 2);
+
+        for (std::vector<Point>::const_iterator it = seen.begin(); it != seen.end(); ++it)
+            lit.set(it->X(), it->Y(), true);
+        std::vector<int> cached;
+        Collect(lit, origin.X(), origin.Y(), radius, cached);
+        cast.clear();
+        ShadowCast(mp->getOpaquePlane(), origin.X(), origin.Y(), radius, lit);
+        Collect(lit, origin.X(), origin.Y(), radius, cast);
+        BOOST_CHECK(cached == cast);
+
+        std::cout << "cave " << size << "x" << size << ", radius " << radius << ": "
+                  << Origins << " redraws without moving, FOVCache " << cached_time << "s"
+                  << std::endl;
+    }
+}
+
+
+int test_main(int, char **)
+{
+    Bench(80, 8);
+    Bench(80, 20);
+    Bench(256, 12);
+    Bench(1024, 40);
+    BenchCache(80, 8);
+    BenchCache(256, 20);
+    return 0;
+}
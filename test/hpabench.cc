@@ -0,0 +1,214 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+// Compares flat A* (Map::pathFind with no route distance) against the
+// cluster hierarchy (Map::routeFind/routeStep) on overworlds of increasing
+// size, reporting time to build the hierarchy, time per query, and how
+// much longer the hierarchical routes are. pathFind with a route distance
+// must give routes as long as routeStep for ends further apart than it,
+// and a walker blocked every few turns must still arrive, as must one
+// whose route is walled up and blocked after it was found (unless the
+// wall cut its goal off) and monsters following Map::updatePath() to far
+// goals.
+
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+#include "boost/test/minimal.hpp"
+
+#include "benchutil.h"
+#include "dice.h"
+#include "dungeonmaster.h"
+#include "map.h"
+#include "monster.h"
+#include "pathfind.h"
+#include "pathhierarchy.h"
+
+
+namespace
+{
+    void Bench(int size, int queries)
+    {
+        DungeonMasterH dm = DungeonMaster::theFactory().create("overworld", "overworld");
+        dm->setLevelSize(size, size);
+        MapH mp = dm->getOrCreateMap(0);
+
+        std::vector<Point> starts, ends;
+        for (int i = 0; i < queries; ++i)
+        {
+            starts.push_back(RandomOpenSquare(mp));
+            ends.push_back(RandomOpenSquare(mp));
+        }
+
+        // the first query builds the hierarchy
+        HierarchicalPath route;
+        std::clock_t begin = std::clock();
+        mp->routeFind(starts[0], ends[0], route);
+        double build = Seconds(begin);
+
+        std::vector<std::size_t> flat_len;
+        std::vector<Point> path;
+        begin = std::clock();
+        for (int i = 0; i < queries; ++i)
+        {
+            mp->pathFind(starts[i], ends[i], CreatureH(), path);
+            flat_len.push_back(path.size());
+        }
+        double flat = Seconds(begin);
+        mp->setRouteDistance(32);
+
+        begin = std::clock();
+        for (int i = 0; i < queries; ++i)
+            mp->routeFind(starts[i], ends[i], route);
+        double abstract = Seconds(begin);
+
+        std::vector<std::size_t> hpa_len;
+        begin = std::clock();
+        for (int i = 0; i < queries; ++i)
+        {
+            std::size_t len = 0;
+            Point at = starts[i];
+            Point step;
+            mp->routeFind(starts[i], ends[i], route);
+            for (; mp->routeStep(route, at, step) && !(step == at); at = step)
+                ++len;
+            BOOST_CHECK(at == (len ? ends[i] : starts[i]));
+            hpa_len.push_back(len);
+        }
+        double refined = Seconds(begin);
+
+        std::vector<std::size_t> routed_len;
+        begin = std::clock();
+        for (int i = 0; i < queries; ++i)
+        {
+            mp->pathFind(starts[i], ends[i], CreatureH(), path);
+            routed_len.push_back(path.size());
+        }
+        double routed = Seconds(begin);
+        for (int i = 0; i < queries; ++i)
+        {
+            bool const far = PathFinder::Heuristic(starts[i].X(), starts[i].Y(), ends[i].X(), ends[i].Y()) > 32;
+            BOOST_CHECK(routed_len[i] == (far ? hpa_len[i] : flat_len[i]));
+        }
+
+        // walkers stopped every third step take up the route again
+        for (int i = 0; i < queries; ++i)
+        {
+            Point at = starts[i];
+            Point step;
+            int turn = 0;
+            mp->routeFind(starts[i], ends[i], route);
+            while (mp->routeStep(route, at, step))
+                if (++turn % 3)
+                    at = step;
+            BOOST_CHECK(hpa_len[i] == 0 || at == ends[i]);
+        }
+
+        // walls and creatures put across routes after they were found are
+        // gone around, but never walked into. A detour is only looked for
+        // within the leg's cluster, so the route gives up on a wall which
+        // closes the only way through it, and waits for a creature to move
+        // on. The walker then plans again from where it stands, and the
+        // creature moves on after a while, as real ones do. Every walker
+        // gets there unless the wall cut the goal off altogether
+        long detours = 0;
+        for (int i = 0; i < queries; ++i)
+        {
+            if (hpa_len[i] < 8)
+                continue;
+            mp->routeFind(starts[i], ends[i], route);
+            std::vector<Point> squares;
+            Point at = starts[i];
+            Point step;
+            for (; mp->routeStep(route, at, step); at = step)
+                squares.push_back(step);
+            Point const wall = squares[squares.size() / 3];
+            Point const blocker = squares[squares.size() * 2 / 3];
+
+            mp->routeFind(starts[i], ends[i], route);
+            Map::Terrain const was = mp->getTerrain(wall);
+            mp->setTerrain(wall, Map::Mountain);
+            mp->addCreature(blocker, Monster::createMonster(Species::Human));
+            bool blocked = true;
+            int waited = 0;
+            int replans = 0;
+            at = starts[i];
+            for (std::size_t turn = 0; turn < squares.size() * 8 && !(at == ends[i]); ++turn)
+            {
+                if (!mp->routeStep(route, at, step))
+                {
+                    if (++replans > 4 || !mp->routeFind(at, ends[i], route))
+                        break;
+                    continue;
+                }
+                BOOST_CHECK(step == at || mp->isPassable(step, CreatureH()));
+                BOOST_CHECK(step == at || !mp->getCreature(step));
+                if (step == at && blocked && ++waited > 4)
+                {
+                    mp->delCreature(blocker);
+                    blocked = false;
+                }
+                at = step;
+            }
+            if (blocked)
+                mp->delCreature(blocker);
+
+            mp->setRouteDistance(0);
+            bool const reachable = mp->pathFind(starts[i], ends[i], CreatureH(), path);
+            mp->setRouteDistance(32);
+            BOOST_CHECK((at == ends[i]) == reachable);
+            detours += at == ends[i];
+            mp->setTerrain(wall, was);
+        }
+
+        // monsters following updatePath() to far goals get there
+        IncrementalPath planner;
+        begin = std::clock();
+        for (int i = 0; i < queries; ++i)
+        {
+            if (hpa_len[i] == 0)
+                continue;
+            CreatureH cr = Monster::createMonster(Species::Human);
+            mp->addCreature(starts[i], cr);
+            Point at = starts[i];
+            Point step;
+            for (std::size_t turn = 0; turn < hpa_len[i] * 2 && !(at == ends[i]); ++turn)
+            {
+                if (!mp->updatePath(planner, at, ends[i], cr, step))
+                    break;
+                mp->moveCreature(step, cr);
+                at = step;
+            }
+            BOOST_CHECK(at == ends[i]);
+            mp->delCreature(at);
+        }
+        double followed = Seconds(begin);
+
+        std::size_t flat_total = 0, hpa_total = 0;
+        for (int i = 0; i < queries; ++i)
+        {
+            BOOST_CHECK((flat_len[i] == 0) == (hpa_len[i] == 0));
+            BOOST_CHECK(hpa_len[i] >= flat_len[i]);
+            flat_total += flat_len[i];
+            hpa_total += hpa_len[i];
+        }
+
+        std::cout << "overworld " << size << "x" << size << ": build " << build
+                  << "s, flat " << flat << "s, abstract " << abstract
+                  << "s, refined " << refined << "s, pathFind routed " << routed
+                  << "s, updatePath followed " << followed << "s, length +"
+                  << (flat_total ? 100.0 * (double(hpa_total) / flat_total - 1.0) : 0.0)
+                  << "% (" << queries << " queries, " << detours << " detours arrived)" << std::endl;
+    }
+}
+
+
+int test_main(int, char **)
+{
+    Bench(256, 100);
+    Bench(1024, 20);
+    Bench(4096, 5);
+    return 0;
+}
@@ -0,0 +1,122 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+// Compares A* against Jump Point Search on CellularAutomata caves, timing
+// both and counting the squares each expands. Paths must be equally long.
+// JPS tests far more squares for passability than it expands, so it is
+// timed both through the Map and against a flat copy of the cave.
+
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+#include "boost/test/minimal.hpp"
+
+#include "benchutil.h"
+#include "dice.h"
+#include "dungeonmaster.h"
+#include "map.h"
+#include "pathfind.h"
+
+
+namespace
+{
+    int const Caves = 4;
+    int const Queries = 400;
+
+    struct Open
+    {
+        explicit Open(Map const & m) : mp(m), size(m.getSize()) {}
+        bool operator()(int x, int y) const
+        {
+            return size.containsPoint(Point(x, y)) && mp.isPassable(Point(x, y), CreatureH()) &&
+                   !mp.getCreature(Point(x, y));
+        }
+        Map const & mp;
+        Point size;
+    };
+
+    struct Grid
+    {
+        explicit Grid(Map const & m) : open(), width(m.getSize().X()), height(m.getSize().Y())
+        {
+            Open const pass(m);
+            for (int y = 0; y < height; ++y)
+                for (int x = 0; x < width; ++x)
+                    open.push_back(pass(x, y));
+        }
+        bool operator()(int x, int y) const
+        {
+            return x >= 0 && y >= 0 && x < width && y < height && open[y * width + x];
+        }
+        std::vector<char> open;
+        int width;
+        int height;
+    };
+
+    template<typename Passable>
+    double Time(PathFinder & finder, Passable const & pass, bool jps,
+                std::vector<Point> const & starts, std::vector<Point> const & ends,
+                std::vector<std::size_t> & lengths, long & expanded)
+    {
+        std::vector<Point> path;
+        lengths.clear();
+        std::clock_t begin = std::clock();
+        for (std::size_t i = 0; i < starts.size(); ++i)
+        {
+            if (jps)
+                finder.findJumpPath(pass, starts[i], ends[i], path);
+            else
+                finder.findPath(pass, starts[i], ends[i], path);
+            expanded += finder.getExpanded();
+            lengths.push_back(path.size());
+        }
+        return Seconds(begin);
+    }
+
+    void Bench(int size)
+    {
+        double astar_time = 0, jps_time = 0, astar_grid = 0, jps_grid = 0;
+        long astar_expanded = 0, jps_expanded = 0, unused = 0;
+
+        for (int cave = 0; cave < Caves; ++cave)
+        {
+            DungeonMasterH dm = DungeonMaster::theFactory().create("cave", "cave");
+            dm->setLevelSize(size, size);
+            MapH mp = dm->getOrCreateMap(0);
+            Open open(*mp);
+            PathFinder finder(size, size);
+
+            std::vector<Point> starts, ends;
+            for (int i = 0; i < Queries; ++i)
+            {
+                starts.push_back(RandomOpenSquare(mp));
+                ends.push_back(RandomOpenSquare(mp));
+            }
+
+            Grid const grid(*mp);
+            std::vector<std::size_t> astar_len, jps_len;
+            astar_time += Time(finder, open, false, starts, ends, astar_len, astar_expanded);
+            jps_time += Time(finder, open, true, starts, ends, jps_len, jps_expanded);
+            BOOST_CHECK(astar_len == jps_len);
+            astar_grid += Time(finder, grid, false, starts, ends, astar_len, unused);
+            jps_grid += Time(finder, grid, true, starts, ends, jps_len, unused);
+            BOOST_CHECK(astar_len == jps_len);
+        }
+
+        std::cout << "cave " << size << "x" << size << ": A* " << astar_time << "s ("
+                  << astar_grid << "s flat), " << astar_expanded / (Caves * Queries)
+                  << " expanded; JPS " << jps_time << "s (" << jps_grid << "s flat), "
+                  << jps_expanded / (Caves * Queries) << " expanded ("
+                  << Caves * Queries << " queries)" << std::endl;
+    }
+}
+
+
+int test_main(int, char **)
+{
+    Bench(80);
+    Bench(256);
+    return 0;
+}
@@ -0,0 +1,169 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+// Times libfov and the A* PathFinder against CellularAutomata caves held
+// in a Matrix2D of each layout. Every layout must light the same squares
+// and find paths of the same length, and libfov must light as many squares
+// as ShadowCast over the same cave, which catches an opacity callback with
+// its sense backwards.
+
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+#include "boost/test/minimal.hpp"
+
+#include "benchutil.h"
+#include "bitplane.h"
+#include "dice.h"
+#include "dmutils.h"
+#include "fov.h"
+#include "matrix2d.h"
+#include "pathfind.h"
+#include "shadowcast.h"
+
+
+namespace
+{
+    int const Origins = 1000;
+    int const Radius = 12;
+    int const Queries = 100;
+
+    template<typename Layout>
+    struct Cave
+    {
+        Cave(DMUtils::CharVec const & cv, int w, int h) :
+            open(w, h, 0), lit(w, h, 0), width(w), height(h)
+        {
+            for (int y = 0; y < h; ++y)
+                for (int x = 0; x < w; ++x)
+                    open(x, y) = cv[y * w + x] != '#';
+        }
+
+        bool operator()(int x, int y) const
+        {
+            return x >= 0 && y >= 0 && x < width && y < height && open(x, y);
+        }
+
+        Matrix2D<char, Layout> open;
+        Matrix2D<char, Layout> lit;
+        int width;
+        int height;
+    };
+
+    template<typename Layout>
+    bool IsOpaque(void *map, int x, int y)
+    {
+        return !(*static_cast<Cave<Layout> *>(map))(x, y);
+    }
+
+    template<typename Layout>
+    void LightCell(void *map, int x, int y, int, int, void *)
+    {
+        Cave<Layout> & cave = *static_cast<Cave<Layout> *>(map);
+        if (x >= 0 && y >= 0 && x < cave.width && y < cave.height)
+            cave.lit(x, y) = 1;
+    }
+
+    template<typename Layout>
+    void Run(char const *name, DMUtils::CharVec const & cv, int size,
+             std::vector<Point> const & starts, std::vector<Point> const & ends,
+             std::vector<long> & results)
+    {
+        Cave<Layout> cave(cv, size, size);
+
+        fov_settings_type fov;
+        fov_settings_init(&fov);
+        fov_settings_set_shape(&fov, FOV_SHAPE_OCTAGON);
+        fov_settings_set_corner_peek(&fov, FOV_CORNER_NOPEEK);
+        fov_settings_set_opaque_apply(&fov, FOV_OPAQUE_APPLY);
+        fov_settings_set_opacity_test_function(&fov, IsOpaque<Layout>);
+        fov_settings_set_apply_lighting_function(&fov, LightCell<Layout>);
+
+        long lit = 0;
+        std::clock_t begin = std::clock();
+        for (int i = 0; i < Origins; ++i)
+        {
+            fov_circle(&fov, &cave, 0, starts[i].X(), starts[i].Y(), Radius);
+            for (int y = starts[i].Y() - Radius; y <= starts[i].Y() + Radius; ++y)
+                for (int x = starts[i].X() - Radius; x <= starts[i].X() + Radius; ++x)
+                    if (x >= 0 && y >= 0 && x < size && y < size)
+                    {
+                        lit += cave.lit(x, y);
+                        cave.lit(x, y) = 0;
+                    }
+        }
+        double const fov_time = Seconds(begin);
+        fov_settings_free(&fov);
+
+        PathFinder finder(size, size);
+        std::vector<Point> path;
+        long length = 0;
+        begin = std::clock();
+        for (int i = 0; i < Queries; ++i)
+        {
+            finder.findPath(cave, starts[i], ends[i], path);
+            length += path.size();
+        }
+        double const path_time = Seconds(begin);
+
+        results.push_back(lit);
+        results.push_back(length);
+        std::cout << "  " << name << ": fov " << fov_time << "s, A* " << path_time
+                  << "s (" << cave.open.storage() << " elements)" << std::endl;
+    }
+
+    // squares lit from each start, as ShadowCast sees it
+    long ShadowLit(DMUtils::CharVec const & cv, int size, std::vector<Point> const & starts)
+    {
+        Bitplane opaque(size, size);
+        for (int i = 0; i < size * size; ++i)
+            opaque.set(i % size, i / size, cv[i] == '#');
+
+        Bitplane lit(size, size);
+        long count = 0;
+        for (int i = 0; i < Origins; ++i)
+        {
+            ShadowCast(opaque, starts[i].X(), starts[i].Y(), Radius, lit);
+            for (int y = starts[i].Y() - Radius; y <= starts[i].Y() + Radius; ++y)
+                for (int x = starts[i].X() - Radius; x <= starts[i].X() + Radius; ++x)
+                    if (lit.test(x, y))
+                    {
+                        ++count;
+                        lit.set(x, y, false);
+                    }
+        }
+        return count;
+    }
+
+    void Bench(int size)
+    {
+        DMUtils::CharVec const cv = DMUtils::CellularAutomata(size, size, '#', 45, 4, 5, 4, true);
+        std::vector<Point> starts, ends;
+        for (int i = 0; i < std::max(Origins, Queries); ++i)
+        {
+            starts.push_back(RandomOpenSquare(cv, size));
+            ends.push_back(RandomOpenSquare(cv, size));
+        }
+
+        std::cout << "cave " << size << "x" << size << ":" << std::endl;
+        std::vector<long> rowmajor, tiled, zorder;
+        Run<RowMajorLayout>("row major", cv, size, starts, ends, rowmajor);
+        Run<TiledLayout>("8x8 tiled", cv, size, starts, ends, tiled);
+        Run<ZOrderLayout>("Z-order  ", cv, size, starts, ends, zorder);
+        BOOST_CHECK(rowmajor == tiled);
+        BOOST_CHECK(rowmajor == zorder);
+        // fov_circle() doesn't light the viewer's own square
+        BOOST_CHECK(rowmajor[0] + Origins == ShadowLit(cv, size, starts));
+    }
+}
+
+
+int test_main(int, char **)
+{
+    Bench(80);
+    Bench(256);
+    Bench(1024);
+    return 0;
+}
@@ -0,0 +1,131 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+// Lights a CellularAutomata cave with hundreds of torches and a few
+// glowing monsters, then plays out turns of monsters wandering, the
+// glowing ones carrying their light, and walls now and then dug out.
+// LightMap::update() each turn is timed against lighting the cave from
+// scratch, and both must end up with the same light on every square.
+
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+#include "boost/test/minimal.hpp"
+
+#include "benchutil.h"
+#include "creature.h"
+#include "dice.h"
+#include "dmutils.h"
+#include "lightmap.h"
+#include "map.h"
+#include "monster.h"
+
+
+namespace
+{
+    int const Turns = 1000;
+    int const Monsters = 100;
+    int const Glowing = 10;
+
+    struct Torch
+    {
+        Point at;
+        int radius;
+        int red, green, blue;
+    };
+
+    void AddTorches(LightMap & lights, std::vector<Torch> const & torches)
+    {
+        for (std::vector<Torch>::const_iterator it = torches.begin(); it != torches.end(); ++it)
+            lights.addSource(it->at, it->radius, it->red, it->green, it->blue);
+    }
+
+    void Bench(int size, int count, int radius)
+    {
+        DMUtils::CharVec const cv = DMUtils::CellularAutomata(size, size, '#', 45, 4, 5, 4, true);
+        MapH mp(new Map(size, size, Map::DirtFloor));
+        for (int i = 0; i < size * size; ++i)
+            if (cv[i] == '#')
+                mp->setTerrain(Point(i % size, i / size), Map::RockWall);
+
+        std::vector<Torch> torches;
+        for (int i = 0; i < count; ++i)
+        {
+            Torch t;
+            mp->getRandomFreeSquare(t.at);
+            t.radius = radius - 2 + Dice::Random0(5);
+            t.red = 128 + Dice::Random0(128);
+            t.green = 64 + Dice::Random0(128);
+            t.blue = Dice::Random0(64);
+            torches.push_back(t);
+        }
+        for (int i = 0; i < Monsters; ++i)
+            mp->addCreature(Map::Random, Monster::createMonster(Species::Human));
+        std::vector<CreatureH> all;
+        mp->getCreatures(all);
+
+        LightMap & lights = mp->getLightMap();
+        AddTorches(lights, torches);
+        std::vector<LightMap::SourceId> glows;
+        for (int i = 0; i < Glowing; ++i)
+            glows.push_back(lights.addSource(all[i]->getCoords(), 3, 0, 0, 200));
+        lights.update(*mp);
+
+        double update_time = 0, scratch_time = 0;
+        for (int turn = 0; turn < Turns; ++turn)
+        {
+            for (std::size_t i = 0; i < all.size(); ++i)
+            {
+                Point const at = all[i]->getCoords();
+                Point const to(at.X() + Dice::Random0(3) - 1, at.Y() + Dice::Random0(3) - 1);
+                if (!mp->getSize().containsPoint(to) || !mp->isPassable(to, all[i]) || mp->getCreature(to))
+                    continue;
+                mp->moveCreature(to, all[i]);
+                if (i < glows.size())
+                    lights.moveSource(glows[i], to);
+            }
+            if (turn % 10 == 0)
+                mp->setTerrain(Point(Dice::Random0(size), Dice::Random0(size)), Map::DirtFloor);
+
+            std::clock_t begin = std::clock();
+            lights.update(*mp);
+            update_time += Seconds(begin);
+
+            begin = std::clock();
+            LightMap scratch(size, size);
+            AddTorches(scratch, torches);
+            for (std::size_t i = 0; i < glows.size(); ++i)
+                scratch.addSource(all[i]->getCoords(), 3, 0, 0, 200);
+            scratch.update(*mp);
+            scratch_time += Seconds(begin);
+
+            if (turn == Turns - 1)
+            {
+                bool same = true;
+                for (int y = 0; y < size; ++y)
+                    for (int x = 0; x < size; ++x)
+                    {
+                        Light const a = lights.getLight(x, y);
+                        Light const b = scratch.getLight(x, y);
+                        same = same && a.red == b.red && a.green == b.green && a.blue == b.blue;
+                    }
+                BOOST_CHECK(same);
+            }
+        }
+
+        std::cout << "cave " << size << "x" << size << ", " << count << " torches of radius ~"
+                  << radius << ", " << Turns << " turns: update " << update_time
+                  << "s (" << lights.getCasts() << " casts), from scratch " << scratch_time
+                  << "s" << std::endl;
+    }
+}
+
+
+int test_main(int, char **)
+{
+    Bench(80, 300, 6);
+    Bench(80, 500, 10);
+    return 0;
+}
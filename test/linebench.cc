@@ -0,0 +1,159 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+// Follows missiles across a CellularAutomata cave until they hit a wall,
+// building each line with TraceLineFromAtoB() against visiting it with
+// traceToOpaque(), then casts area spells whose rays run out to every
+// square of a ring, one TraceLineFromAtoB() per ray against a single
+// VisitLinesFrom(). Both ways must stop at the same squares, and missiles
+// leaving an open map must stop at its edge.
+
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+#include "boost/test/minimal.hpp"
+
+#include "benchutil.h"
+#include "dice.h"
+#include "dmutils.h"
+#include "map.h"
+
+
+namespace
+{
+    int const Shots = 100000;
+    int const Spells = 2000;
+
+    // first opaque square after the start, or the end
+    Point BuildAndStop(Map const & mp, Point a, Point b)
+    {
+        std::vector<Point> const line = Map::TraceLineFromAtoB(a, b);
+        for (std::size_t i = 1; i < line.size(); ++i)
+            if (mp.getOpaquePlane().test(line[i].X(), line[i].Y()))
+                return line[i];
+        return b;
+    }
+
+    // squares reached by each ray of a spell, stopping at walls
+    struct Burn
+    {
+        Burn(Map const & mp, Point a) : opaque(mp.getOpaquePlane()), start(a), squares(0) {}
+
+        bool operator()(std::size_t, Point at)
+        {
+            ++squares;
+            return at == start || !opaque.test(at.X(), at.Y());
+        }
+
+        Bitplane const & opaque;
+        Point start;
+        long squares;
+    };
+
+    void Bench(int size, int radius)
+    {
+        DMUtils::CharVec const cv = DMUtils::CellularAutomata(size, size, '#', 45, 4, 5, 4, true);
+        MapH mp(new Map(size, size, Map::DirtFloor));
+        for (int i = 0; i < size * size; ++i)
+            if (cv[i] == '#')
+                mp->setTerrain(Point(i % size, i / size), Map::RockWall);
+
+        std::vector<Point> from, to;
+        for (int i = 0; i < Shots; ++i)
+        {
+            Point p;
+            mp->getRandomFreeSquare(p);
+            from.push_back(p);
+            to.push_back(Point(Dice::Random0(size), Dice::Random0(size)));
+        }
+
+        long built = 0, visited = 0;
+        std::clock_t begin = std::clock();
+        for (int i = 0; i < Shots; ++i)
+        {
+            Point const stop = BuildAndStop(*mp, from[i], to[i]);
+            built += stop.X() + stop.Y();
+        }
+        double const build_time = Seconds(begin);
+
+        begin = std::clock();
+        for (int i = 0; i < Shots; ++i)
+        {
+            Point const stop = mp->traceToOpaque(from[i], to[i]);
+            visited += stop.X() + stop.Y();
+        }
+        double const visit_time = Seconds(begin);
+        BOOST_CHECK(built == visited);
+
+        // every square of the square ring radius out
+        std::vector<Point> ring;
+        for (int d = -radius; d < radius; ++d)
+        {
+            ring.push_back(Point(d, -radius));
+            ring.push_back(Point(radius, d));
+            ring.push_back(Point(-d, radius));
+            ring.push_back(Point(-radius, -d));
+        }
+
+        long burnt_built = 0;
+        std::vector<Point> ends(ring.size());
+        begin = std::clock();
+        for (int i = 0; i < Spells; ++i)
+            for (std::size_t r = 0; r < ring.size(); ++r)
+            {
+                std::vector<Point> const line = Map::TraceLineFromAtoB(from[i], from[i] + ring[r]);
+                for (std::size_t j = 0; j < line.size(); ++j)
+                {
+                    ++burnt_built;
+                    if (j > 0 && mp->getOpaquePlane().test(line[j].X(), line[j].Y()))
+                        break;
+                }
+            }
+        double const spell_build_time = Seconds(begin);
+
+        long burnt_visited = 0;
+        begin = std::clock();
+        for (int i = 0; i < Spells; ++i)
+        {
+            for (std::size_t r = 0; r < ring.size(); ++r)
+                ends[r] = from[i] + ring[r];
+            Burn burn(*mp, from[i]);
+            Map::VisitLinesFrom(from[i], ends, burn);
+            burnt_visited += burn.squares;
+        }
+        double const spell_visit_time = Seconds(begin);
+        BOOST_CHECK(burnt_built == burnt_visited);
+
+        std::cout << "cave " << size << "x" << size << ": " << Shots << " missiles, TraceLineFromAtoB "
+                  << build_time << "s, traceToOpaque " << visit_time << "s; " << Spells
+                  << " spells of " << ring.size() << " rays, TraceLineFromAtoB "
+                  << spell_build_time << "s, VisitLinesFrom " << spell_visit_time << "s" << std::endl;
+    }
+
+    // missiles flying off an open map stop at its edge
+    void Edges(int size)
+    {
+        MapH mp(new Map(size, size, Map::DirtFloor));
+        Point const centre(size / 2, size / 2);
+        BOOST_CHECK(mp->traceToOpaque(centre, Point(size * 2, size / 2)) == Point(size - 1, size / 2));
+        BOOST_CHECK(mp->traceToOpaque(centre, Point(size / 2, -size)) == Point(size / 2, 0));
+        BOOST_CHECK(mp->traceToOpaque(centre, Point(-size, -size)) == Point(0, 0));
+        for (int i = 0; i < Shots / 100; ++i)
+        {
+            Point const stop = mp->traceToOpaque(centre, Point(Dice::Random0(size * 3) - size,
+                                                               Dice::Random0(size * 3) - size));
+            BOOST_CHECK(mp->getSize().containsPoint(stop));
+        }
+    }
+}
+
+
+int test_main(int, char **)
+{
+    Edges(40);
+    Bench(80, 6);
+    Bench(256, 12);
+    return 0;
+}
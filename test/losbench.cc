@@ -0,0 +1,125 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+// Scatters monsters over a CellularAutomata cave and has each look for
+// the hero every turn, through Map::canSee() one at a time, through
+// Map::canSeeMany() all at once and through Map::canSeeHero() after
+// lookForHero(), against building the line with TraceLineFromAtoB() for
+// every look. All four must agree, and canSee() must give the same answer
+// both ways round.
+
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+#include "boost/test/minimal.hpp"
+
+#include "benchutil.h"
+#include "creature.h"
+#include "dice.h"
+#include "dmutils.h"
+#include "map.h"
+#include "monster.h"
+
+
+namespace
+{
+    int const Turns = 200;
+    int const Sight = 12;
+
+    bool TraceSees(Map const & mp, Point a, Point b, int radius)
+    {
+        int const dx = a.X() - b.X();
+        int const dy = a.Y() - b.Y();
+        if (dx * dx + dy * dy > radius * radius)
+            return false;
+        if (b < a)
+            std::swap(a, b);
+        std::vector<Point> const line = Map::TraceLineFromAtoB(a, b);
+        for (std::size_t i = 1; i + 1 < line.size(); ++i)
+            if (mp.getOpaquePlane().test(line[i].X(), line[i].Y()))
+                return false;
+        return true;
+    }
+
+    void Bench(int size, int monsters)
+    {
+        DMUtils::CharVec const cv = DMUtils::CellularAutomata(size, size, '#', 45, 4, 5, 4, true);
+        MapH mp(new Map(size, size, Map::DirtFloor));
+        for (int i = 0; i < size * size; ++i)
+            if (cv[i] == '#')
+                mp->setTerrain(Point(i % size, i / size), Map::RockWall);
+        for (int i = 0; i < monsters; ++i)
+            mp->addCreature(Map::Random, Monster::createMonster(Species::Human));
+
+        std::vector<CreatureH> all;
+        mp->getCreatures(all);
+        std::vector<Point> from(all.size());
+        std::vector<char> many;
+        long seen_one = 0, seen_many = 0, seen_looked = 0, seen_trace = 0;
+        double one_time = 0, many_time = 0, look_time = 0, trace_time = 0;
+        bool symmetric = true;
+        Point hero;
+        mp->getRandomFreeSquare(hero);
+
+        for (int turn = 0; turn < Turns; ++turn)
+        {
+            // everyone takes a step, the hero every fourth turn
+            for (std::vector<CreatureH>::iterator it = all.begin(); it != all.end(); ++it)
+            {
+                Point const at = (*it)->getCoords();
+                Point const to(at.X() + Dice::Random0(3) - 1, at.Y() + Dice::Random0(3) - 1);
+                if (mp->getSize().containsPoint(to) && mp->isPassable(to, *it) && !mp->getCreature(to))
+                    mp->moveCreature(to, *it);
+            }
+            if (turn % 4 == 0)
+                mp->getRandomFreeSquare(hero);
+            for (std::size_t i = 0; i < all.size(); ++i)
+                from[i] = all[i]->getCoords();
+
+            std::clock_t begin = std::clock();
+            for (std::size_t i = 0; i < from.size(); ++i)
+                seen_one += mp->canSee(from[i], hero, Sight);
+            one_time += Seconds(begin);
+
+            begin = std::clock();
+            mp->canSeeMany(from, hero, Sight, many);
+            many_time += Seconds(begin);
+            for (std::size_t i = 0; i < many.size(); ++i)
+                seen_many += many[i];
+
+            begin = std::clock();
+            mp->lookForHero(hero, Sight);
+            for (std::size_t i = 0; i < from.size(); ++i)
+                seen_looked += mp->canSeeHero(from[i], hero, Sight);
+            look_time += Seconds(begin);
+
+            begin = std::clock();
+            for (std::size_t i = 0; i < from.size(); ++i)
+                seen_trace += TraceSees(*mp, from[i], hero, Sight);
+            trace_time += Seconds(begin);
+
+            for (std::size_t i = 0; i < from.size(); i += 16)
+                symmetric = symmetric && mp->canSee(from[i], hero, Sight) == mp->canSee(hero, from[i], Sight);
+        }
+
+        BOOST_CHECK(seen_one == seen_trace);
+        BOOST_CHECK(seen_many == seen_trace);
+        BOOST_CHECK(seen_looked == seen_trace);
+        BOOST_CHECK(symmetric);
+        std::cout << "cave " << size << "x" << size << ", " << all.size() << " monsters, "
+                  << Turns << " turns: canSee " << one_time << "s, canSeeMany " << many_time
+                  << "s, lookForHero " << look_time
+                  << "s, TraceLineFromAtoB " << trace_time << "s (" << seen_trace
+                  << " sightings)" << std::endl;
+    }
+}
+
+
+int test_main(int, char **)
+{
+    Bench(80, 200);
+    Bench(256, 2000);
+    return 0;
+}
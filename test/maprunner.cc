@@ -0,0 +1,217 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+// Builds the same set of maps full of random walkers from one seed several
+// times over, and advances them round by round: once a map at a time in
+// Timeline order, as World does with no background threads, and then with
+// MapRunner on 0, 1, 3 and 8 worker threads. Every walker must take the
+// same steps on the same turns each time. Then has a walker throw, which
+// must come out of run() on the calling thread, and the MapRunner must
+// still work afterwards.
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "boost/test/minimal.hpp"
+
+#include "creature.h"
+#include "dice.h"
+#include "error.h"
+#include "map.h"
+#include "maprunner.h"
+#include "timeline.h"
+
+
+namespace
+{
+    int const MapCount = 12;
+    int const MapSize = 48;
+    int const Walkers = 40;
+    unsigned int const Rounds = 10;
+    unsigned int const RoundTurns = 60;
+
+    struct Step
+    {
+        unsigned int turn;
+        Point        at;
+        bool operator==(Step const & r) const { return turn == r.turn && at == r.at; }
+    };
+
+    /**
+     * Steps to a random neighbouring square, and takes a random while
+     * about it, drawing both from whichever Dice is current. Throws once
+     * it reaches the turn it was told to trip on.
+     */
+    class Walker : public Creature
+    {
+    public:
+        explicit Walker(unsigned int trip) : Creature(), m_trip(trip), m_steps() {}
+
+        std::vector<Step> const & getSteps() const { return m_steps; }
+
+        virtual unsigned int act()
+        {
+            if (getTurn() >= m_trip)
+                throw std::runtime_error("walker tripped");
+
+            Coords const here(getCoords());
+            Point const step(here.X() + Dice::Random0(3) - 1, here.Y() + Dice::Random0(3) - 1);
+            CreatureH me(getCreatureHandle());
+            if (here.M()->getSize().containsPoint(step) && here.M()->isPassable(step, me) &&
+                !here.M()->getCreature(step))
+                here.M()->moveCreature(step, me);
+            Step const taken = { getTurn(), getCoords() };
+            m_steps.push_back(taken);
+            return getSpeed() + Dice::Random0(3);
+        }
+
+        virtual Speed getSpeed() const { return Actor::Normal; }
+        virtual void updateView() {}
+        virtual StatPair getStat(Stat) const { return StatPair(5, 5); }
+        virtual Creature::Type creatureType() const { return Creature::Monster; }
+        virtual int heroGUID() const { return 0; }
+        virtual int getSightRadius() const { return 0; }
+        virtual Representation getRepresentation(CreatureH) const { return Representation('w', Colour::Orange); }
+        virtual ItemPileH getInventory() const { return ItemPileH(); }
+        virtual ItemH getInvInSlot(Species::BodySlot::Type) const { return ItemH(); }
+        virtual ItemH swapInvInSlot(Species::BodySlot::Type, ItemH it) { return it; }
+        virtual void levelUp() {}
+        virtual Gender getGender() const { return Neuter; }
+        virtual int getAttackBonus(CreatureH) const { return 0; }
+        virtual int getDefenseBonus(CreatureH) const { return 0; }
+        virtual std::vector<Damage> getCombatDamage(CreatureH, bool) const { return std::vector<Damage>(); }
+        virtual void applyDamage(Damage const &) {}
+        virtual bool deceased() const { return false; }
+        virtual bool hasSkill(Skills::Type, int) const { return false; }
+        virtual std::string describe(CreatureH) const { return "walker"; }
+        virtual std::string describe() const { return "walker"; }
+        virtual std::string describeIndef(CreatureH) const { return "a walker"; }
+        virtual std::string describeIndef() const { return "a walker"; }
+
+    protected:
+        virtual Classes::ClassLevels getClassLevels() const { return Classes::ClassLevels(); }
+
+    private:
+        unsigned int      m_trip;
+        std::vector<Step> m_steps;
+    };
+
+    typedef boost::shared_ptr<Walker> WalkerH;
+
+    struct Scene
+    {
+        std::vector<MapH>    maps;
+        std::vector<WalkerH> walkers;   // in the order they were made
+
+        std::vector<Map *> getMaps() const
+        {
+            std::vector<Map *> out;
+            for (std::size_t i = 0; i < maps.size(); ++i)
+                out.push_back(maps[i].get());
+            return out;
+        }
+    };
+
+    // everything, the maps' own Dice included, comes from the seed
+    Scene Build(int seed, unsigned int trip)
+    {
+        Dice dice(0, 32767, seed);
+        Dice::Stream stream(dice);
+        Scene scene;
+        for (int m = 0; m < MapCount; ++m)
+        {
+            MapH mp(new Map(MapSize, MapSize, Map::DirtFloor));
+            for (int i = 0; i < MapSize * MapSize / 5; ++i)
+                mp->setTerrain(Point(Dice::Random0(MapSize), Dice::Random0(MapSize)), Map::RockWall);
+            for (int i = 0; i < Walkers; ++i)
+            {
+                WalkerH w(new Walker(m == MapCount / 2 && i == 0 ? trip : ~0U));
+                if (mp->addCreature(Map::Random, w))
+                    scene.walkers.push_back(w);
+            }
+            scene.maps.push_back(mp);
+        }
+        return scene;
+    }
+
+    // what World::mainLoop() does with no background threads
+    void RunInOrder(Scene const & scene, unsigned int turn)
+    {
+        Timeline timeline;
+        for (std::size_t i = 0; i < scene.maps.size(); ++i)
+            timeline.add(scene.maps[i]);
+        for (Map *mp = timeline.next(); mp->getNextTurn() <= turn; mp = timeline.next())
+        {
+            Dice::Stream stream(mp->getDice());
+            ActorH actor = mp->getNextActor();
+            mp->updateActor(actor, actor->act());
+        }
+    }
+
+    bool SameSteps(Scene const & l, Scene const & r)
+    {
+        if (l.walkers.size() != r.walkers.size())
+            return false;
+        for (std::size_t i = 0; i < l.walkers.size(); ++i)
+            if (!(l.walkers[i]->getSteps() == r.walkers[i]->getSteps()))
+                return false;
+        return true;
+    }
+
+    void CheckDeterministic(int seed)
+    {
+        Scene want = Build(seed, ~0U);
+        for (unsigned int round = 1; round <= Rounds; ++round)
+            RunInOrder(want, round * RoundTurns);
+        BOOST_CHECK(!want.walkers.empty() && !want.walkers[0]->getSteps().empty());
+
+        int const threads[] = { 0, 1, 3, 8 };
+        for (std::size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); ++t)
+        {
+            Scene got = Build(seed, ~0U);
+            std::vector<Map *> const maps = got.getMaps();
+            MapRunner runner(threads[t]);
+            for (unsigned int round = 1; round <= Rounds; ++round)
+                runner.run(maps, round * RoundTurns);
+            BOOST_CHECK(SameSteps(want, got));
+        }
+    }
+
+    void CheckThrow(int threads)
+    {
+        Scene scene = Build(7, RoundTurns / 2);
+        std::vector<Map *> const maps = scene.getMaps();
+        MapRunner runner(threads);
+        bool caught = false;
+        try
+        {
+            runner.run(maps, RoundTurns);
+        }
+        catch (Error<ThreadE> const & e)
+        {
+            caught = std::string(e.what()).find("walker tripped") != std::string::npos;
+        }
+        BOOST_CHECK(caught);
+
+        // the workers are all back at the start, ready for another round
+        std::vector<Map *> rest(maps);
+        rest.erase(rest.begin() + MapCount / 2);
+        runner.run(rest, RoundTurns);
+        bool done = true;
+        for (std::size_t i = 0; i < rest.size(); ++i)
+            done = done && rest[i]->getNextTurn() > RoundTurns;
+        BOOST_CHECK(done);
+    }
+}
+
+
+int test_main(int, char **)
+{
+    CheckDeterministic(1);
+    CheckDeterministic(12345);
+    CheckThrow(0);
+    CheckThrow(3);
+    return 0;
+}
@@ -0,0 +1,263 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+// Compares the flat-array PathFinder used by Map::pathFind against the
+// original multi_index/std::set A* on maps from the cave, town and
+// overworld generators. Then walks IncrementalPath (D* Lite) routes across
+// random grids while squares are toggled between steps, checking every
+// repaired route against a fresh PathFinder search.
+
+#include <ctime>
+#include <iostream>
+#include <set>
+#include <stack>
+#include <string>
+#include <vector>
+
+#include "boost/multi_index_container.hpp"
+#include "boost/multi_index/ordered_index.hpp"
+#include "boost/multi_index/identity.hpp"
+#include "boost/multi_index/member.hpp"
+#include "boost/test/minimal.hpp"
+
+#include "benchutil.h"
+#include "dice.h"
+#include "dungeonmaster.h"
+#include "map.h"
+#include "pathfind.h"
+
+
+//============================================================================
+// The original Map::pathFind, kept here as the reference implementation
+//============================================================================
+namespace Legacy
+{
+    Point Offsets[8] = { Point(-1, -1), Point(0, -1), Point(1, -1),
+                          Point(-1, 0),                 Point(1, 0),
+                          Point(-1, 1),  Point(0, 1),  Point(1, 1) };
+
+    struct Node;
+    typedef std::set<Node>         ClosedList;
+    typedef ClosedList::iterator   ClosedIter;
+    struct Node
+    {
+        Point      coord;
+        ClosedIter  parent;
+        int         cost;
+        int         total_cost;
+
+        Node(Point here, ClosedIter p, int cost_here, int total) :
+            coord(here), parent(p), cost(cost_here), total_cost(total) {}
+        bool operator< (Node const & rh) const
+        { return coord < rh.coord; }
+    };
+
+    using namespace boost::multi_index;
+    typedef multi_index_container<
+                                  Node,
+                                  indexed_by<
+                                             ordered_unique<identity<Node> >,
+                                             ordered_non_unique<member<Node, int, &Node::total_cost> >
+                                            >
+                                 > OpenList;
+
+    void AddOrUpdateOpenList(OpenList & open_list, Node & node)
+    {
+        OpenList::iterator it = open_list.get<0>().find(node);
+        if (it != open_list.get<0>().end())
+        {
+            if (it->cost > node.cost)
+                open_list.get<0>().replace(it, node);
+            return;
+        }
+        open_list.insert(node);
+    }
+
+    std::vector<Point> const & CalculatePath(Point final, ClosedIter parent, ClosedIter end, std::vector<Point> & path)
+    {
+        std::stack<Point> c_list;
+        c_list.push(final);
+        for ( ; parent != end && parent->parent != end; parent = parent->parent)
+            c_list.push(parent->coord);
+        while (!c_list.empty())
+        {
+            path.push_back(c_list.top());
+            c_list.pop();
+        }
+        return path;
+    }
+
+    std::vector<Point> PathFind(Map const & mp, Point s, Point e, CreatureH cr)
+    {
+        std::vector<Point> path;
+        if (s == e) return path;
+
+        OpenList open_list;
+        ClosedList closed_list;
+        open_list.insert(Node(s, closed_list.end(), 0, Map::ManhattanDistance(s, e)));
+
+        while (!open_list.empty())
+        {
+            ClosedIter parent = closed_list.insert(*open_list.get<1>().begin()).first;
+            open_list.erase(*open_list.get<1>().begin());
+
+            for (int sq = 0; sq < 8; ++sq)
+            {
+                Point square =  parent->coord + Offsets[sq];
+                if (square.X() == e.X() && square.Y() == e.Y())
+                    return CalculatePath(square, parent, closed_list.end(), path);
+                if (!mp.isPassable(square, cr) || mp.getCreature(square)) continue;
+                Node node(square, parent, parent->cost + 1, parent->cost + 1 + Map::ManhattanDistance(square, e));
+                if (closed_list.count(node)) continue;
+                AddOrUpdateOpenList(open_list, node);
+            }
+        }
+        return path;
+    }
+}
+
+
+//============================================================================
+// Benchmark
+//============================================================================
+namespace
+{
+    int const Queries = 400;
+    int const Walks = 200;
+    int const Toggles = 4;
+
+    void Bench(std::string const & dmtype)
+    {
+        DungeonMasterH dm = DungeonMaster::theFactory().create(dmtype, dmtype);
+        MapH mp = dm->getOrCreateMap(0);
+
+        std::vector<Point> starts, ends;
+        for (int i = 0; i < Queries; ++i)
+        {
+            starts.push_back(RandomOpenSquare(mp));
+            ends.push_back(RandomOpenSquare(mp));
+        }
+
+        std::vector<std::size_t> legacy_len;
+        std::clock_t begin = std::clock();
+        for (int i = 0; i < Queries; ++i)
+            legacy_len.push_back(Legacy::PathFind(*mp, starts[i], ends[i], CreatureH()).size());
+        double legacy = Seconds(begin);
+
+        std::vector<std::size_t> flat_len;
+        std::vector<Point> path;
+        begin = std::clock();
+        for (int i = 0; i < Queries; ++i)
+        {
+            mp->pathFind(starts[i], ends[i], CreatureH(), path);
+            flat_len.push_back(path.size());
+        }
+        double flat = Seconds(begin);
+
+        BOOST_CHECK(legacy_len == flat_len);
+        std::cout << dmtype << " " << mp->getSize().X() << "x" << mp->getSize().Y()
+                  << ": legacy " << legacy << "s, flat " << flat << "s ("
+                  << Queries << " queries)" << std::endl;
+    }
+
+    struct Grid
+    {
+        Grid(int w, int h) : width(w), height(h), blocked(w * h, 0) {}
+        bool operator()(int x, int y) const
+        {
+            return x >= 0 && y >= 0 && x < width && y < height && !blocked[y * width + x];
+        }
+        Point randomOpen() const
+        {
+            for (;;)
+            {
+                Point c(Dice::Random0(width), Dice::Random0(height));
+                if ((*this)(c.X(), c.Y()))
+                    return c;
+            }
+        }
+        int width;
+        int height;
+        std::vector<char> blocked;
+    };
+
+    // every step of a route is to a neighbouring open square, but the goal
+    bool FollowsGrid(Grid const & grid, Point s, Point e, std::vector<Point> const & path)
+    {
+        for (std::size_t i = 0; i < path.size(); ++i)
+        {
+            Point const from = i ? path[i - 1] : s;
+            if (PathFinder::Heuristic(from.X(), from.Y(), path[i].X(), path[i].Y()) != 1)
+                return false;
+            if (!(path[i] == e) && !grid(path[i].X(), path[i].Y()))
+                return false;
+        }
+        return path.empty() || path.back() == e;
+    }
+
+    void BenchIncremental(int size, int percent)
+    {
+        Grid grid(size, size);
+        for (int i = 0; i < size * size; ++i)
+            grid.blocked[i] = Dice::Random0(100) < percent;
+
+        PathFinder finder(size, size);
+        IncrementalPath planner;
+        std::vector<Point> path;
+        long steps = 0, mismatches = 0, broken = 0;
+        double incremental = 0, scratch = 0;
+        for (int walk = 0; walk < Walks; ++walk)
+        {
+            Point here = grid.randomOpen();
+            Point const goal = grid.randomOpen();
+            planner.reset(1, size, here, goal);
+            while (!(here == goal))
+            {
+                // squares change near and far, but never under the walker
+                std::clock_t begin = std::clock();
+                for (int t = 0; t < Toggles; ++t)
+                {
+                    Point const c(Dice::Random0(size), Dice::Random0(size));
+                    if (c == here)
+                        continue;
+                    grid.blocked[c.Y() * size + c.X()] ^= 1;
+                    planner.squareChanged(grid, c);
+                }
+                bool const found = planner.computePath(grid);
+                incremental += Seconds(begin);
+
+                begin = std::clock();
+                bool const expected = finder.findPath(grid, here, goal, path);
+                scratch += Seconds(begin);
+
+                ++steps;
+                if (found != expected || (found && planner.getPath().size() != path.size()))
+                    ++mismatches;
+                if (found && !FollowsGrid(grid, here, goal, planner.getPath()))
+                    ++broken;
+                if (!found)
+                    break;
+                planner.nextStep(here);
+                planner.moveStart(here);
+            }
+        }
+
+        BOOST_CHECK(mismatches == 0);
+        BOOST_CHECK(broken == 0);
+        std::cout << "random " << size << "x" << size << " " << percent << "% blocked: IncrementalPath "
+                  << incremental << "s, PathFinder " << scratch << "s (" << steps
+                  << " steps, " << Toggles << " squares toggled per step)" << std::endl;
+    }
+}
+
+
+int test_main(int, char **)
+{
+    Bench("cave");
+    Bench("town");
+    Bench("overworld");
+    BenchIncremental(48, 20);
+    BenchIncremental(128, 30);
+    return 0;
+}
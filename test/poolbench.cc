@@ -0,0 +1,97 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+// Solves one batch of queries across a map scattered with monsters both
+// with Map::pathFind, one at a time, and with Map::pathFindMany on the
+// path threads, in A* and JPS modes, timing each. Half the queries start
+// from a monster's square, which must not stand in its own way. Both must
+// find exactly the same paths.
+
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "boost/test/minimal.hpp"
+
+#include "benchutil.h"
+#include "dice.h"
+#include "dungeonmaster.h"
+#include "map.h"
+#include "monster.h"
+#include "pathpool.h"
+
+
+namespace
+{
+    void Bench(std::string const & dmtype, int size, int monsters, int queries)
+    {
+        DungeonMasterH dm = DungeonMaster::theFactory().create(dmtype, dmtype);
+        dm->setLevelSize(size, size);
+        MapH mp = dm->getOrCreateMap(0);
+
+        std::vector<CreatureH> creatures;
+        for (int i = 0; i < monsters; ++i)
+        {
+            CreatureH cr = Monster::createMonster(Species::Human);
+            mp->addCreature(RandomOpenSquare(mp), cr);
+            creatures.push_back(cr);
+        }
+
+        std::vector<Point> starts, goals;
+        std::vector<CreatureH> movers;
+        for (int i = 0; i < queries; ++i)
+        {
+            CreatureH cr = i % 2 ? creatures[Dice::Random0(monsters)] : CreatureH();
+            starts.push_back(cr ? Point(cr->getCoords()) : RandomOpenSquare(mp));
+            goals.push_back(RandomOpenSquare(mp));
+            movers.push_back(cr);
+        }
+
+        for (int mode = 0; mode < 2; ++mode)
+        {
+            mp->setPathMode(mode ? Map::JumpPoint : Map::AStar);
+
+            std::vector<std::vector<Point> > want(queries);
+            std::vector<bool> want_found(queries);
+            std::clock_t begin = std::clock();
+            for (int i = 0; i < queries; ++i)
+                want_found[i] = mp->pathFind(starts[i], goals[i], movers[i], want[i]);
+            double const single = Seconds(begin);
+
+            std::vector<std::vector<Point> > got(queries);
+            std::vector<PathQuery> batch;
+            for (int i = 0; i < queries; ++i)
+                batch.push_back(PathQuery(starts[i], goals[i], &got[i]));
+            begin = std::clock();
+            mp->pathFindMany(batch);
+            double const many = Seconds(begin);
+
+            bool same = true;
+            int found = 0;
+            for (int i = 0; i < queries; ++i)
+            {
+                same = same && batch[i].found == want_found[i] && got[i] == want[i];
+                found += want_found[i];
+            }
+            BOOST_CHECK(same);
+            BOOST_CHECK(found > queries / 2);
+
+            // clock() counts every thread's time, so pathFindMany only
+            // shows the work done, not the time waited
+            std::cout << dmtype << " " << size << "x" << size << (mode ? " JPS" : " A*")
+                      << ": pathFind " << single << "s, pathFindMany " << many
+                      << "s of processor time (" << found << " of " << queries
+                      << " found, " << monsters << " monsters)" << std::endl;
+        }
+    }
+}
+
+
+int test_main(int, char **)
+{
+    Bench("overworld", 256, 400, 400);
+    Bench("overworld", 1024, 2000, 100);
+    return 0;
+}
@@ -0,0 +1,118 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+// Puts a Timeline of maps through thousands of random changes: Actors
+// rescheduled, added and removed on any map, maps emptied, and maps taken
+// out of the Timeline and put back. After each, next() must be the map a
+// scan of them all picks: the soonest next turn, equal turns going to the
+// lowest address, and empty maps last. Maps left out must not be picked.
+
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "boost/test/minimal.hpp"
+
+#include "creature.h"
+#include "dice.h"
+#include "map.h"
+#include "monster.h"
+#include "timeline.h"
+
+
+namespace
+{
+    int const Size = 8;
+
+    Map * Scan(std::vector<MapH> const & maps, std::set<Map *> const & in)
+    {
+        std::pair<unsigned int, Map *> best(~0U, 0);
+        for (std::size_t i = 0; i < maps.size(); ++i)
+        {
+            std::pair<unsigned int, Map *> const entry(maps[i]->getNextTurn(), maps[i].get());
+            if (in.count(entry.second) && (!best.second || entry < best))
+                best = entry;
+        }
+        return best.second;
+    }
+
+    void CheckEmpty()
+    {
+        Timeline timeline;
+        BOOST_CHECK(timeline.empty() && timeline.next() == 0);
+
+        MapH mp(new Map(Size, Size, Map::DirtFloor));
+        timeline.add(mp);
+        BOOST_CHECK(!timeline.empty() && timeline.next() == mp.get());
+        timeline.remove(mp);
+        BOOST_CHECK(timeline.empty() && timeline.next() == 0);
+    }
+
+    void CheckRandom(int mapcount, int ops)
+    {
+        Timeline timeline;
+        std::vector<MapH> maps;
+        std::set<Map *> in;
+        for (int i = 0; i < mapcount; ++i)
+        {
+            maps.push_back(MapH(new Map(Size, Size, Map::DirtFloor)));
+            timeline.add(maps.back());
+            in.insert(maps.back().get());
+        }
+
+        bool same = true;
+        for (int op = 0; op < ops; ++op)
+        {
+            MapH const & mp = maps[Dice::Random0(mapcount)];
+            std::vector<CreatureH> creatures;
+            mp->getCreatures(creatures);
+            int const roll = Dice::Random0(20);
+            if (roll < 5 && static_cast<int>(creatures.size()) < Size * Size)
+            {
+                Point c;
+                do
+                    c = Point(Dice::Random0(Size), Dice::Random0(Size));
+                while (mp->getCreature(c));
+                CreatureH cr = Monster::createMonster(Species::Human);
+                mp->addCreature(c, cr);
+                mp->updateActor(cr, Dice::Random0(50));
+            }
+            else if (roll < 15 && !creatures.empty())
+            {
+                mp->updateActor(creatures[Dice::Random0(static_cast<int>(creatures.size()))], Dice::Random0(8));
+            }
+            else if (roll < 18 && !creatures.empty())
+            {
+                mp->delCreature(creatures[Dice::Random0(static_cast<int>(creatures.size()))]->getCoords());
+            }
+            else if (roll == 18)
+            {
+                for (std::size_t i = 0; i < creatures.size(); ++i)
+                    mp->delCreature(creatures[i]->getCoords());
+            }
+            else if (in.count(mp.get()))
+            {
+                timeline.remove(mp);
+                in.erase(mp.get());
+            }
+            else
+            {
+                timeline.add(mp);
+                in.insert(mp.get());
+            }
+
+            same = same && timeline.next() == Scan(maps, in) && timeline.empty() == in.empty();
+        }
+        BOOST_CHECK(same);
+    }
+}
+
+
+int test_main(int, char **)
+{
+    CheckEmpty();
+    CheckRandom(2, 2000);
+    CheckRandom(20, 20000);
+    return 0;
+}
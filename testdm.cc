@@ -86,7 +86,7 @@ public:
         {
             int xx = Dice::Random0(mapsz_x);
             int yy = Dice::Random0(mapsz_y);
-            Coords coord(xx, yy);
+            Point coord(xx, yy);
             if (tmp->getTerrain(coord) == Map::Grass)
             {
                 for (int j = 0; j < 40; ++j)
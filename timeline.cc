@@ -0,0 +1,69 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#include <cassert>
+
+#include "map.h"
+#include "timeline.h"
+
+//============================================================================
+// Timeline
+//============================================================================
+Timeline::Timeline() :
+    m_order(),
+    m_entries()
+{
+}
+
+
+Timeline::~Timeline()
+{
+    for (Order::iterator it = m_order.begin(); it != m_order.end(); ++it)
+        it->second->setTimeline(0);
+}
+
+
+void
+Timeline::add(MapH mp)
+{
+    if (m_entries.count(mp.get()))
+        return;
+    Entry const ent(mp->getNextTurn(), mp.get());
+    m_order.insert(ent);
+    m_entries.insert(Entries::value_type(mp.get(), ent));
+    mp->setTimeline(this);
+}
+
+
+void
+Timeline::remove(MapH mp)
+{
+    Entries::iterator it = m_entries.find(mp.get());
+    if (it == m_entries.end())
+        return;
+    m_order.erase(it->second);
+    m_entries.erase(it);
+    mp->setTimeline(0);
+}
+
+
+void
+Timeline::update(Map const * mp)
+{
+    Entries::iterator it = m_entries.find(mp);
+    assert(it != m_entries.end() && "update() called for Map not in Timeline");
+    unsigned int const turn = mp->getNextTurn();
+    if (it->second.first == turn)
+        return;
+    m_order.erase(it->second);
+    it->second.first = turn;
+    m_order.insert(it->second);
+}
+
+
+Map *
+Timeline::next() const
+{
+    return m_order.empty() ? 0 : m_order.begin()->second;
+}
@@ -0,0 +1,76 @@
+// -*- Mode: C++ -*-
+// RogueMonkey copyright 2008 Adam White theroguemonkey@gmail.com
+// Released under the GPL version 2 - refer to included file LICENCE.txt
+
+#ifndef H_TIMELINE_
+#define H_TIMELINE_ 1
+
+#include <map>
+#include <set>
+#include <utility>
+
+#include "boost/noncopyable.hpp"
+
+#include "handles.h"
+
+
+/**
+ * Timeline orders the Maps in play by the turn of the next Actor on each,
+ * so the next Actor in the whole World is found in O(log maps). A Map in a
+ * Timeline reports whenever the head of its own queue changes; Maps with
+ * no Actors sort last. Equal turns go to the lowest Map address, as the
+ * old scan over World's std::set<MapH> did.
+ */
+class Timeline : private boost::noncopyable
+{
+public:
+    Timeline();
+    ~Timeline();
+
+    /**
+     * Is there a map in the timeline?
+     *
+     * @return      true if there are no maps
+     */
+    bool empty() const { return m_order.empty(); }
+
+    /**
+     * Add a Map, and have it report changes to this Timeline
+     *
+     * @param mp    map to add
+     */
+    void add(MapH mp);
+
+    /**
+     * Take a Map out
+     *
+     * @param mp    map to remove
+     */
+    void remove(MapH mp);
+
+    /**
+     * Reposition a Map after the head of its queue has changed
+     *
+     * @param mp    map in this timeline
+     */
+    void update(Map const * mp);
+
+    /**
+     * Map whose next Actor acts soonest
+     *
+     * @return      map, or 0 if the timeline is empty
+     */
+    Map * next() const;
+
+private:
+    typedef std::pair<unsigned int, Map *>   Entry;
+    typedef std::set<Entry>                  Order;
+    typedef std::map<Map const *, Entry>     Entries;
+
+    Order   m_order;
+    Entries m_entries;
+};
+
+
+
+#endif
@@ -87,7 +87,7 @@ public:
         {
             int xx = Dice::Random0(mapsz_x);
             int yy = Dice::Random0(mapsz_y);
-            Coords coord(xx, yy);
+            Point coord(xx, yy);
             if (tmp->getTerrain(coord) == Map::Grass)
             {
                 tmp->addItem(coord, Item::createItem(Dice::Random0(100) > 49 ? Item::Weapon : Item::Weapon));
@@ -98,11 +98,13 @@ public:
         {
             int xx = Dice::Random0(mapsz_x);
             int yy = Dice::Random0(mapsz_y);
-            Coords coord(xx, yy);
+            Point coord(xx, yy);
             if (tmp->getTerrain(coord) == Map::Grass)
             {
+                // stop once the town is full
                 CreatureH cr = Creature::create(Creature::Monster, Species::Human);
-                tmp->addCreature(Map::Default, cr);
+                if (!tmp->addCreature(Map::Default, cr))
+                    break;
             }
         }
         return tmp;
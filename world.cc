@@ -3,24 +3,32 @@
 // Released under the GPL version 2 - refer to included file LICENCE.txt
 
 #include <cassert>
-#include <limits>
+#include <cstdlib>
 
 #include "boost/scoped_ptr.hpp"
 
+#include "actor.h"
+#include "dice.h"
 #include "display.h"
 #include "dungeonmaster.h"
 #include "hero.h"
 #include "inputdef.h"
 #include "map.h"
+#include "maprunner.h"
 #include "textutils.h"
 #include "world.h"
 
 namespace
 {
     boost::scoped_ptr<World> worldsingleton(0);
+
+    // how far Map::lookForHero() gathers monsters after each hero turn.
+    // Any who see further look for themselves
+    int const LookRange = 12;
 }
 
 
+
 //=========================================================================
 // World
 //=========================================================================
@@ -45,13 +53,23 @@ World::Init()
 
 World::World() :
     m_dms(),
-    m_maps_in_play()
+    m_maps_in_play(),
+    m_timeline(),
+    m_background(),
+    m_abstract(120),
+    m_hero_map(0),
+    m_abstract_distance(0)
 {
     DungeonMasterH overworld = createDM("cave", "cave");
     addMapToCurrentList(overworld->getOrCreateMap(0));
 }
 
 
+World::~World()
+{
+}
+
+
 
 DungeonMasterH
 World::createDM(std::string const & type, std::string const & name)
@@ -66,26 +84,44 @@ World::createDM(std::string const & type, std::string const & name)
 void
 World::mainLoop(HeroH hero)
 {
-    getDMByName("cave")->getOrCreateMap(0)->addCreature(Map::Default, hero);
+    if (!getDMByName("cave")->getOrCreateMap(0)->addCreature(Map::Default, hero))
+        assert(!"mainLoop failed - no free square for the hero");
 
     // Now start the main game logic
-    while(!m_maps_in_play.empty())
+    while(!m_timeline.empty())
     {
-        // Process new turn. Find next Actor by high watermark
-        unsigned int next_action = std::numeric_limits<unsigned int>::max();
-        ActorH next_actor;
+        // Process new turn. The timeline keeps the map with the soonest Actor first
+        if ((m_abstract_distance || !m_abstract.empty()) && hero->getCoords().M().get() != m_hero_map)
+        {
+            refreshDetail(hero);
+            continue;
+        }
+
+        Map *mp = m_timeline.next();
+        if (!m_abstract.empty())
+            m_abstract.advance(mp->getNextTurn());
+        if (m_background && !mp->hasHero() && hero->getCoords().M())
+        {
+            advanceBackground(hero->getTurn());
+            continue;
+        }
 
-        for(MapsInPlay::iterator it = m_maps_in_play.begin(); it != m_maps_in_play.end(); ++it)
+        ActorH next_actor = mp->getNextActor();
+        unsigned int next_action;
         {
-            if ((*it)->getNextActor()->getTurn() < next_action)
-            {
-                next_actor = (*it)->getNextActor();
-                next_action = next_actor->getTurn();
-            }
+            Dice::Stream stream(mp->getDice());
+            next_action = next_actor->act();
         }
-        next_action = next_actor->act();
         assert(next_actor->getCoords().M().get() && "Invalid Map in Coords for Actor!");
         next_actor->getCoords().M()->updateActor(next_actor, next_action);
+
+        // monsters near the hero look for them in one pass, and answer
+        // from that on their own turns
+        if (next_actor == hero)
+        {
+            Coords const at(hero->getCoords());
+            at.M()->lookForHero(at, LookRange);
+        }
     }
     return;
 }
@@ -108,6 +144,8 @@ void
 World::addMapToCurrentList(MapH mp)
 {
     m_maps_in_play.insert(mp);
+    m_timeline.add(mp);
+    m_hero_map = 0;
 }
 
 
@@ -115,10 +153,103 @@ World::addMapToCurrentList(MapH mp)
 void
 World::removeMapFromCurrentList(MapH mp)
 {
+    m_abstract.remove(mp);
+    m_timeline.remove(mp);
     m_maps_in_play.erase(mp);
 }
 
 
+void
+World::setBackgroundThreads(int threads)
+{
+    assert(threads >= 0 && "Illegal thread count submitted to setBackgroundThreads()");
+    m_background.reset(threads ? new MapRunner(threads) : 0);
+}
+
+
+// the maps leave the timeline while they run, as its ordering is shared.
+// They go back even if an Actor threw, for whoever catches it
+void
+World::advanceBackground(unsigned int turn)
+{
+    std::vector<Map *> maps;
+    for (MapsInPlay::iterator it = m_maps_in_play.begin(); it != m_maps_in_play.end(); ++it)
+    {
+        if (!(*it)->hasHero() && !m_abstract.contains(*it))
+        {
+            m_timeline.remove(*it);
+            maps.push_back(it->get());
+        }
+    }
+
+    try
+    {
+        m_background->run(maps, turn);
+    }
+    catch (...)
+    {
+        for (std::vector<Map *>::iterator it = maps.begin(); it != maps.end(); ++it)
+            m_timeline.add((*it)->shared_from_this());
+        throw;
+    }
+
+    for (std::vector<Map *>::iterator it = maps.begin(); it != maps.end(); ++it)
+        m_timeline.add((*it)->shared_from_this());
+}
+
+
+void
+World::setAbstractDistance(int levels, unsigned int quantum)
+{
+    assert(levels >= 0 && quantum > 0 && "Illegal settings submitted to setAbstractDistance()");
+    m_abstract_distance = levels;
+    m_abstract.setQuantum(quantum);
+    m_hero_map = 0;
+}
 
 
+DungeonMasterH
+World::findDM(Map const * mp, int & level) const
+{
+    for (DMs::const_iterator it = m_dms.begin(); it != m_dms.end(); ++it)
+    {
+        level = it->second->findLevel(mp);
+        if (level >= 0)
+            return it->second;
+    }
+    return DungeonMasterH();
+}
 
+
+// only called when the hero changes map, so scanning every map is fine
+void
+World::refreshDetail(HeroH hero)
+{
+    MapH heromap = hero->getCoords().M();
+    m_hero_map = heromap.get();
+    unsigned int const now = hero->getTurn();
+    int herolevel = 0;
+    DungeonMasterH herodm = heromap ? findDM(heromap.get(), herolevel) : DungeonMasterH();
+
+    for (MapsInPlay::iterator it = m_maps_in_play.begin(); it != m_maps_in_play.end(); ++it)
+    {
+        int level = 0;
+        DungeonMasterH dm = findDM(it->get(), level);
+        int distance = 0;
+        if (heromap && dm && herodm)
+            distance = dm == herodm ? std::abs(level - herolevel) : level + herolevel + 1;
+        bool const far = dm && m_abstract_distance && distance > m_abstract_distance;
+
+        bool const abstract = m_abstract.contains(*it);
+        if (far && !abstract)
+        {
+            m_timeline.remove(*it);
+            m_abstract.add(*it, dm, now);
+        }
+        else if (!far && abstract)
+        {
+            m_abstract.restore(*it, now);
+            m_timeline.add(*it);
+        }
+    }
+}
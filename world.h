@@ -11,10 +11,14 @@
 
 #include "boost/shared_ptr.hpp"
 #include "boost/noncopyable.hpp"
+#include "boost/scoped_ptr.hpp"
 
+#include "abstractmaps.h"
 #include "dungeonmaster.h"
 #include "handles.h"
+#include "timeline.h"
 
+class MapRunner;
 
 
 /**
@@ -36,6 +40,8 @@ public:
      */
     static void Init();
 
+    ~World();
+
     /**
      * Commence game
      */
@@ -63,6 +69,35 @@ public:
      */
     void removeMapFromCurrentList(MapH mp);
 
+    /**
+     * Simulate the maps the hero isn't on with worker threads. Whenever
+     * one of those maps is next in line, every one of them is brought up
+     * to the hero's turn at once, each on whichever thread takes it, and
+     * the hero only acts once they have all finished. Actors always draw
+     * from their own Map's Dice, so results are the same with any number
+     * of threads. Actors on those maps must not touch any other Map.
+     * The one shared thing they may read is the hero, through HERO, as
+     * it doesn't act until the workers are done. Anything an Actor throws
+     * on a worker is thrown again from mainLoop() once the round ends.
+     *
+     * @param threads  worker threads besides the main one, 0 to run every
+     *                 map in turn on the main thread as before
+     */
+    void setBackgroundThreads(int threads);
+
+    /**
+     * Simulate maps far from the hero coarsely. A map more than levels
+     * away (counting down a DM's levels, or up through level 0 and down
+     * again for another DM) leaves the timeline, and every quantum ticks
+     * its DungeonMaster::simulateAbstract() passes that much time at once.
+     * When the hero comes within range again, the map is caught up to the
+     * present and its Actors resume acting one by one.
+     *
+     * @param levels   distance beyond which maps go abstract, 0 for never
+     * @param quantum  ticks passed in each abstract step
+     */
+    void setAbstractDistance(int levels, unsigned int quantum = 120);
+
 private:
     typedef std::map<std::string, DungeonMasterH> DMs;
     typedef std::set<MapH>                        MapsInPlay;
@@ -70,9 +105,17 @@ private:
 
     World();
     DungeonMasterH createDM(std::string const & type, std::string const & name);
+    void advanceBackground(unsigned int turn);
+    void refreshDetail(HeroH hero);
+    DungeonMasterH findDM(Map const * mp, int & level) const;
 
     DMs                   m_dms;
     MapsInPlay            m_maps_in_play;
+    Timeline              m_timeline;
+    boost::scoped_ptr<MapRunner> m_background;
+    AbstractMaps          m_abstract;
+    Map const *           m_hero_map;
+    int                   m_abstract_distance;
 };
 
 